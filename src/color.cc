@@ -21,7 +21,6 @@ void SetupColors() {
     init_pair(kHierNamePair, COLOR_WHITE, kBackground);
     init_pair(kHierMatchedNamePair, 11, kBackground); // yellow
     init_pair(kHierTypePair, COLOR_CYAN, kBackground);
-    init_pair(kHierShowMorePair, COLOR_YELLOW, kBackground);
     init_pair(kHierOtherPair, 13, kBackground);           // bright magenta
     init_pair(kHierErrPair, 9, kBackground);              // bright red
     init_pair(kTooltipPair, COLOR_BLACK, COLOR_YELLOW);   // yellow background
@@ -17,7 +17,6 @@ constexpr int kHierExpandPair = 7;
 constexpr int kHierNamePair = 8;
 constexpr int kHierTypePair = 9;
 constexpr int kHierErrPair = 10;
-constexpr int kHierShowMorePair = 11;
 constexpr int kHierOtherPair = 12;
 constexpr int kHierMatchedNamePair = 13;
 constexpr int kTooltipPair = 14;
@@ -0,0 +1,400 @@
+#include "connectivity_graph.h"
+#include "uhdm_utils.h"
+#include <algorithm>
+#include <deque>
+#include <string_view>
+#include <uhdm/array_net.h>
+#include <uhdm/array_var.h>
+#include <uhdm/assignment.h>
+#include <uhdm/begin.h>
+#include <uhdm/bit_select.h>
+#include <uhdm/cont_assign.h>
+#include <uhdm/design.h>
+#include <uhdm/do_while.h>
+#include <uhdm/event_control.h>
+#include <uhdm/for_stmt.h>
+#include <uhdm/gen_scope.h>
+#include <uhdm/gen_scope_array.h>
+#include <uhdm/if_else.h>
+#include <uhdm/if_stmt.h>
+#include <uhdm/module_inst.h>
+#include <uhdm/named_begin.h>
+#include <uhdm/net.h>
+#include <uhdm/operation.h>
+#include <uhdm/part_select.h>
+#include <uhdm/port.h>
+#include <uhdm/process_stmt.h>
+#include <uhdm/ref_obj.h>
+#include <uhdm/sv_vpi_user.h>
+#include <uhdm/tf_call.h>
+#include <uhdm/uhdm_vpi_user.h>
+#include <uhdm/variables.h>
+#include <uhdm/vpi_user.h>
+#include <uhdm/while_stmt.h>
+
+namespace sv {
+
+// Walks the design the same way GetDriversOrLoads() searches a scope, but
+// records what it finds for all nets at once.
+class ConnectivityGraph::Builder {
+ public:
+  explicit Builder(absl::flat_hash_map<const UHDM::any *, Node> *nodes)
+      : nodes_(nodes) {}
+  // Adds the instance and everything below it.
+  void AddInstances(const UHDM::module_inst *top);
+
+ private:
+  // Module or generate scope being walked, with its declarations by name, to
+  // find what bit selects refer to. Those are only gathered when needed.
+  struct Scope {
+    const UHDM::any *item;
+    absl::flat_hash_map<std::string_view, const UHDM::any *> names;
+    bool names_built = false;
+  };
+
+  template <typename T>
+  void AddScope(const T *scope);
+  template <typename T>
+  void AddGenScopes(const T *scope);
+  template <typename T>
+  void AddNames(const T *scope, Scope *s);
+  void AddStmt(const UHDM::any *stmt);
+  // Adds the conditions of a statement to those of the ones it contains.
+  void AddConditionalStmt(const UHDM::any *condition,
+                          std::initializer_list<const UHDM::any *> stmts);
+  void AddAssign(const UHDM::any *lhs, const UHDM::any *rhs);
+  // Collects the net references in an expression.
+  void CollectRefs(const UHDM::any *expr,
+                   std::vector<const UHDM::any *> *refs);
+  // The net a reference is to, or nullptr if it can't be found.
+  const UHDM::any *Resolve(const UHDM::any *ref);
+  void AddDrivers(const std::vector<const UHDM::any *> &refs);
+  void AddLoads(const std::vector<const UHDM::any *> &refs);
+  // Adds edges from the nets of one set of references to those of another.
+  void Connect(const std::vector<const UHDM::any *> &from,
+               const std::vector<const UHDM::any *> &to);
+
+  absl::flat_hash_map<const UHDM::any *, Node> *nodes_;
+  // Innermost scope last.
+  std::vector<Scope> scopes_;
+  // References in the conditions of the statements being walked.
+  std::vector<const UHDM::any *> conditions_;
+  // Instances still to be walked.
+  std::vector<const UHDM::module_inst *> pending_;
+};
+
+void ConnectivityGraph::Builder::AddInstances(const UHDM::module_inst *top) {
+  pending_.push_back(top);
+  while (!pending_.empty()) {
+    const UHDM::module_inst *m = pending_.back();
+    pending_.pop_back();
+    scopes_.clear();
+    scopes_.push_back({.item = m, .names = {}, .names_built = false});
+    AddScope(m);
+    // Inputs and inouts are drivers, outputs and inouts are loads.
+    if (m->Ports() != nullptr) {
+      for (auto p : *m->Ports()) {
+        const UHDM::any *low = p->Low_conn();
+        if (low == nullptr || low->VpiType() != vpiRefObj) continue;
+        const UHDM::any *net = Resolve(low);
+        if (net == nullptr) continue;
+        auto &node = (*nodes_)[net];
+        if (p->VpiDirection() == vpiInput || p->VpiDirection() == vpiInout) {
+          node.drivers.push_back(p);
+        }
+        if (p->VpiDirection() == vpiOutput || p->VpiDirection() == vpiInout) {
+          node.loads.push_back(p);
+        }
+      }
+    }
+    AddGenScopes(m);
+  }
+}
+
+// Both Modules and GenScopes work here, see FindInContainer().
+template <typename T>
+void ConnectivityGraph::Builder::AddScope(const T *scope) {
+  if (scope->Cont_assigns() != nullptr) {
+    for (auto &ca : *scope->Cont_assigns()) {
+      AddAssign(ca->Lhs(), ca->Rhs());
+    }
+  }
+  if (scope->Process() != nullptr) {
+    for (auto &p : *scope->Process()) {
+      AddStmt(p->Stmt());
+    }
+  }
+  if (scope->Modules() != nullptr) {
+    for (auto sub : *scope->Modules()) {
+      pending_.push_back(sub);
+      if (sub->Ports() == nullptr) continue;
+      for (auto p : *sub->Ports()) {
+        std::vector<const UHDM::any *> refs;
+        CollectRefs(p->High_conn(), &refs);
+        // The net inside the instance, which isn't in this scope.
+        std::vector<const UHDM::any *> inner;
+        if (p->Low_conn() != nullptr &&
+            p->Low_conn()->VpiType() == vpiRefObj) {
+          inner.push_back(p->Low_conn());
+        }
+        if (p->VpiDirection() != vpiInput) {
+          AddDrivers(refs);
+          Connect(inner, refs);
+        }
+        if (p->VpiDirection() != vpiOutput) {
+          AddLoads(refs);
+          Connect(refs, inner);
+        }
+      }
+    }
+  }
+}
+
+template <typename T>
+void ConnectivityGraph::Builder::AddGenScopes(const T *scope) {
+  if (scope->Gen_scope_arrays() == nullptr) return;
+  for (auto ga : *scope->Gen_scope_arrays()) {
+    if (ga->Gen_scopes() == nullptr) continue;
+    for (auto g : *ga->Gen_scopes()) {
+      scopes_.push_back({.item = g, .names = {}, .names_built = false});
+      AddScope(g);
+      AddGenScopes(g);
+      scopes_.pop_back();
+    }
+  }
+}
+
+template <typename T>
+void ConnectivityGraph::Builder::AddNames(const T *scope, Scope *s) {
+  if (scope->Variables() != nullptr) {
+    for (auto &v : *scope->Variables()) {
+      s->names.emplace(v->VpiName(), v);
+    }
+  }
+  if (scope->Nets() != nullptr) {
+    for (auto &n : *scope->Nets()) {
+      s->names.emplace(n->VpiName(), n);
+    }
+  }
+  if (scope->Array_nets() != nullptr) {
+    for (auto &a : *scope->Array_nets()) {
+      s->names.emplace(a->VpiName(), a);
+    }
+  }
+  if (scope->Array_vars() != nullptr) {
+    for (auto &a : *scope->Array_vars()) {
+      s->names.emplace(a->VpiName(), a);
+    }
+  }
+}
+
+void ConnectivityGraph::Builder::AddStmt(const UHDM::any *stmt) {
+  if (stmt == nullptr) return;
+  const int type = stmt->VpiType();
+  if (type == vpiBegin) {
+    auto b = dynamic_cast<const UHDM::begin *>(stmt);
+    if (b->Stmts() != nullptr) {
+      for (auto s : *b->Stmts()) AddStmt(s);
+    }
+  } else if (type == vpiNamedBegin) {
+    auto nb = dynamic_cast<const UHDM::named_begin *>(stmt);
+    if (nb->Stmts() != nullptr) {
+      for (auto s : *nb->Stmts()) AddStmt(s);
+    }
+  } else if (type == vpiFuncCall || type == vpiTaskCall) {
+    // Arguments can go either way.
+    std::vector<const UHDM::any *> refs;
+    CollectRefs(stmt, &refs);
+    AddDrivers(refs);
+    AddLoads(refs);
+  } else if (type == vpiAssignment) {
+    auto assignment = dynamic_cast<const UHDM::assignment *>(stmt);
+    AddAssign(assignment->Lhs(), assignment->Rhs());
+  } else if (type == vpiEventControl) {
+    auto ec = dynamic_cast<const UHDM::event_control *>(stmt);
+    AddConditionalStmt(ec->VpiCondition(), {ec->Stmt()});
+  } else if (type == vpiIf) {
+    auto is = dynamic_cast<const UHDM::if_stmt *>(stmt);
+    AddConditionalStmt(is->VpiCondition(), {is->VpiStmt()});
+  } else if (type == vpiIfElse) {
+    auto ie = dynamic_cast<const UHDM::if_else *>(stmt);
+    AddConditionalStmt(ie->VpiCondition(), {ie->VpiStmt(), ie->VpiElseStmt()});
+  } else if (type == vpiFor) {
+    AddStmt(dynamic_cast<const UHDM::for_stmt *>(stmt)->VpiStmt());
+  } else if (type == vpiWhile) {
+    AddStmt(dynamic_cast<const UHDM::while_stmt *>(stmt)->VpiStmt());
+  } else if (type == vpiDoWhile) {
+    AddStmt(dynamic_cast<const UHDM::do_while *>(stmt)->VpiStmt());
+  }
+}
+
+void ConnectivityGraph::Builder::AddConditionalStmt(
+    const UHDM::any *condition,
+    std::initializer_list<const UHDM::any *> stmts) {
+  std::vector<const UHDM::any *> refs;
+  CollectRefs(condition, &refs);
+  AddLoads(refs);
+  const int num_conditions = conditions_.size();
+  conditions_.insert(conditions_.end(), refs.begin(), refs.end());
+  for (auto s : stmts) AddStmt(s);
+  conditions_.resize(num_conditions);
+}
+
+void ConnectivityGraph::Builder::AddAssign(const UHDM::any *lhs,
+                                           const UHDM::any *rhs) {
+  std::vector<const UHDM::any *> lhs_refs, rhs_refs;
+  CollectRefs(lhs, &lhs_refs);
+  CollectRefs(rhs, &rhs_refs);
+  AddDrivers(lhs_refs);
+  AddLoads(rhs_refs);
+  // What the assignment depends on includes when it's made.
+  rhs_refs.insert(rhs_refs.end(), conditions_.begin(), conditions_.end());
+  Connect(rhs_refs, lhs_refs);
+}
+
+void ConnectivityGraph::Builder::CollectRefs(
+    const UHDM::any *expr, std::vector<const UHDM::any *> *refs) {
+  if (expr == nullptr) return;
+  const int type = expr->VpiType();
+  if (type == vpiOperation) {
+    auto op = dynamic_cast<const UHDM::operation *>(expr);
+    if (op->Operands() != nullptr) {
+      for (auto o : *op->Operands()) CollectRefs(o, refs);
+    }
+  } else if (type == vpiFuncCall || type == vpiTaskCall) {
+    auto tfc = dynamic_cast<const UHDM::tf_call *>(expr);
+    if (tfc->Tf_call_args() != nullptr) {
+      for (auto a : *tfc->Tf_call_args()) CollectRefs(a, refs);
+    }
+  } else if (type == vpiBitSelect || type == vpiPartSelect ||
+             type == vpiRefObj) {
+    refs->push_back(expr);
+  }
+}
+
+const UHDM::any *ConnectivityGraph::Builder::Resolve(const UHDM::any *ref) {
+  const int type = ref->VpiType();
+  if (type == vpiRefObj) {
+    return dynamic_cast<const UHDM::ref_obj *>(ref)->Actual_group();
+  }
+  if (type == vpiPartSelect) {
+    const UHDM::any *parent = ref->VpiParent();
+    if (parent == nullptr || parent->VpiType() != vpiRefObj) return nullptr;
+    return dynamic_cast<const UHDM::ref_obj *>(parent)->Actual_group();
+  }
+  // Bit selects only have the name, look it up from the innermost scope out.
+  for (auto it = scopes_.rbegin(); it != scopes_.rend(); ++it) {
+    if (!it->names_built) {
+      if (it->item->VpiType() == vpiModule) {
+        AddNames(dynamic_cast<const UHDM::module_inst *>(it->item), &*it);
+      } else {
+        AddNames(dynamic_cast<const UHDM::gen_scope *>(it->item), &*it);
+      }
+      it->names_built = true;
+    }
+    const auto name_it = it->names.find(ref->VpiName());
+    if (name_it != it->names.end()) return name_it->second;
+  }
+  return nullptr;
+}
+
+void ConnectivityGraph::Builder::AddDrivers(
+    const std::vector<const UHDM::any *> &refs) {
+  for (auto ref : refs) {
+    if (const UHDM::any *net = Resolve(ref)) {
+      (*nodes_)[net].drivers.push_back(ref);
+    }
+  }
+}
+
+void ConnectivityGraph::Builder::AddLoads(
+    const std::vector<const UHDM::any *> &refs) {
+  for (auto ref : refs) {
+    if (const UHDM::any *net = Resolve(ref)) {
+      (*nodes_)[net].loads.push_back(ref);
+    }
+  }
+}
+
+void ConnectivityGraph::Builder::Connect(
+    const std::vector<const UHDM::any *> &from,
+    const std::vector<const UHDM::any *> &to) {
+  if (from.empty() || to.empty()) return;
+  std::vector<const UHDM::any *> to_nets;
+  for (auto ref : to) {
+    if (const UHDM::any *net = Resolve(ref)) to_nets.push_back(net);
+  }
+  for (auto ref : from) {
+    const UHDM::any *from_net = Resolve(ref);
+    if (from_net == nullptr) continue;
+    for (auto to_net : to_nets) {
+      if (from_net == to_net) continue;
+      (*nodes_)[from_net].fanout.push_back(to_net);
+      (*nodes_)[to_net].fanin.push_back(from_net);
+    }
+  }
+}
+
+ConnectivityGraph::ConnectivityGraph(const UHDM::design *design) {
+  if (design->TopModules() != nullptr) {
+    Builder builder(&nodes_);
+    for (auto top : *design->TopModules()) {
+      builder.AddInstances(top);
+    }
+  }
+  // Nets are usually connected through more than one reference.
+  auto dedup = [](std::vector<const UHDM::any *> *nets) {
+    std::sort(nets->begin(), nets->end());
+    nets->erase(std::unique(nets->begin(), nets->end()), nets->end());
+    nets->shrink_to_fit();
+  };
+  for (auto &[net, node] : nodes_) {
+    dedup(&node.fanin);
+    dedup(&node.fanout);
+  }
+}
+
+void ConnectivityGraph::DriversOrLoads(
+    const UHDM::any *item, bool drivers,
+    std::vector<const UHDM::any *> *list) const {
+  list->clear();
+  if (item == nullptr) return;
+  // For RefObjects, trace the actual net it's referring to.
+  if (item->VpiType() == vpiRefObj) {
+    item = dynamic_cast<const UHDM::ref_obj *>(item)->Actual_group();
+  }
+  if (item == nullptr || !IsTraceable(item)) return;
+  const auto it = nodes_.find(item);
+  if (it == nodes_.end()) return;
+  *list = drivers ? it->second.drivers : it->second.loads;
+}
+
+std::vector<std::pair<const UHDM::any *, int>>
+ConnectivityGraph::Cone(const UHDM::any *item, bool drivers,
+                        int max_depth) const {
+  std::vector<std::pair<const UHDM::any *, int>> cone;
+  if (item == nullptr) return cone;
+  if (item->VpiType() == vpiRefObj) {
+    item = dynamic_cast<const UHDM::ref_obj *>(item)->Actual_group();
+  }
+  absl::flat_hash_map<const UHDM::any *, int> depths;
+  depths[item] = 0;
+  // Breadth first, so that each net is reached through its shortest path.
+  std::deque<const UHDM::any *> queue = {item};
+  while (!queue.empty()) {
+    const UHDM::any *net = queue.front();
+    queue.pop_front();
+    const int depth = depths[net];
+    if (depth == max_depth) continue;
+    const auto it = nodes_.find(net);
+    if (it == nodes_.end()) continue;
+    for (auto next : drivers ? it->second.fanin : it->second.fanout) {
+      if (!depths.emplace(next, depth + 1).second) continue;
+      cone.push_back({next, depth + 1});
+      queue.push_back(next);
+    }
+  }
+  return cone;
+}
+
+} // namespace sv
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "absl/container/flat_hash_map.h"
+#include <utility>
+#include <vector>
+
+namespace UHDM {
+class any;
+class design;
+} // namespace UHDM
+
+namespace sv {
+
+// Index of how the nets of an elaborated design connect, built with one pass
+// over all instances. Each net gets the items that drive and load it, as
+// found by GetDriversOrLoads(), and the nets those connect it to: through
+// assignments, the conditions they are made under, and port connections across
+// the hierarchy. Tracing a net is then a lookup, and fan-in and fan-out cones
+// a walk over the graph, instead of a search through the source of the scope.
+//
+// Building takes a while on large designs, so it's meant to be done on a
+// background thread. Once built, the graph is read-only and can be used from
+// any thread.
+class ConnectivityGraph {
+ public:
+  explicit ConnectivityGraph(const UHDM::design *design);
+  // The same as GetDriversOrLoads().
+  void DriversOrLoads(const UHDM::any *item, bool drivers,
+                      std::vector<const UHDM::any *> *list) const;
+  // The nets in the fan-in (drivers) or fan-out cone of the item, up to
+  // max_depth nets away, with their distance. Nearest nets come first, and
+  // the item itself isn't included.
+  std::vector<std::pair<const UHDM::any *, int>>
+  Cone(const UHDM::any *item, bool drivers, int max_depth) const;
+
+ private:
+  struct Node {
+    // Where the net is driven or loaded in the source.
+    std::vector<const UHDM::any *> drivers;
+    std::vector<const UHDM::any *> loads;
+    // Nets this one is driven by, and drives.
+    std::vector<const UHDM::any *> fanin;
+    std::vector<const UHDM::any *> fanout;
+  };
+  class Builder;
+
+  absl::flat_hash_map<const UHDM::any *, Node> nodes_;
+};
+
+} // namespace sv
@@ -0,0 +1,141 @@
+#include "design_signal_map.h"
+#include "utils.h"
+#include <string>
+#include <uhdm/array_net.h>
+#include <uhdm/array_var.h>
+#include <uhdm/gen_scope.h>
+#include <uhdm/gen_scope_array.h>
+#include <uhdm/module_inst.h>
+#include <uhdm/net.h>
+#include <uhdm/ref_obj.h>
+#include <uhdm/variables.h>
+#include <uhdm/vpi_user.h>
+#include <utility>
+
+namespace sv {
+namespace {
+
+// Helper match, since the design names have a "work@" prefix.
+bool ScopeMatch(std::string_view design_scope, std::string_view signal_scope) {
+  auto pos = design_scope.find(signal_scope);
+  if (pos == std::string::npos) return false;
+  if (design_scope.size() == signal_scope.size() || pos == 0) return true;
+  return design_scope[pos - 1] == '@';
+};
+
+} // namespace
+
+DesignSignalMap::DesignSignalMap(const UHDM::any *design_scope,
+                                 const WaveData::SignalScope *signal_scope) {
+  if (design_scope == nullptr || signal_scope == nullptr) return;
+  // Surelog always has an unrolled list of gen scope arrays with a single
+  // generate scope as the only child.
+  if (design_scope->VpiType() == vpiGenScopeArray) {
+    const auto *ga = dynamic_cast<const UHDM::gen_scope_array *>(design_scope);
+    if (ga->Gen_scopes() == nullptr || ga->Gen_scopes()->empty()) return;
+    design_scope = (*ga->Gen_scopes())[0];
+  }
+  AddScope(design_scope, signal_scope);
+}
+
+void DesignSignalMap::AddScope(const UHDM::any *design_scope,
+                               const WaveData::SignalScope *signal_scope) {
+  if (design_scope->VpiType() == vpiModule) {
+    AddScope(dynamic_cast<const UHDM::module_inst *>(design_scope),
+             signal_scope);
+  } else if (design_scope->VpiType() == vpiGenScope) {
+    AddScope(dynamic_cast<const UHDM::gen_scope *>(design_scope),
+             signal_scope);
+  }
+}
+
+// Modules and GenScopes have the same set of methods, but they are not
+// virtual.
+template <typename T>
+void DesignSignalMap::AddScope(const T *design_scope,
+                               const WaveData::SignalScope *signal_scope) {
+  absl::flat_hash_map<std::string, const UHDM::any *> items;
+  absl::flat_hash_map<std::string, const UHDM::any *> arrays;
+  if (design_scope->Nets() != nullptr) {
+    for (const auto *n : *design_scope->Nets()) {
+      items.emplace(StripWorklib(n->VpiName()), n);
+    }
+  }
+  if (design_scope->Variables() != nullptr) {
+    for (const auto *v : *design_scope->Variables()) {
+      items.emplace(StripWorklib(v->VpiName()), v);
+    }
+  }
+  if (design_scope->Array_nets() != nullptr) {
+    for (const auto *a : *design_scope->Array_nets()) {
+      arrays.emplace(StripWorklib(a->VpiName()), a);
+    }
+  }
+  if (design_scope->Array_vars() != nullptr) {
+    for (const auto *a : *design_scope->Array_vars()) {
+      arrays.emplace(StripWorklib(a->VpiName()), a);
+    }
+  }
+  auto find = [](const auto &map, std::string_view name) -> const UHDM::any * {
+    const auto it = map.find(name);
+    return it == map.end() ? nullptr : it->second;
+  };
+  for (const auto &signal : signal_scope->signals) {
+    const std::string_view base = signal.name.substr(0, signal.name.find('['));
+    // Signals of array elements go with the array, but bits of a vector
+    // aren't the vector itself.
+    const UHDM::any *item = find(items, signal.name);
+    if (item == nullptr) item = find(arrays, base);
+    if (item != nullptr) design_items_[&signal] = item;
+    const UHDM::any *owner = find(items, base);
+    if (owner == nullptr) owner = find(arrays, base);
+    if (owner != nullptr) signals_[owner].push_back(&signal);
+  }
+
+  if (signal_scope->children.empty()) return;
+  // Sub-scopes by name, instances taking precedence over generate blocks.
+  std::vector<std::pair<std::string, const UHDM::any *>> children;
+  if (design_scope->Modules() != nullptr) {
+    for (const auto *sub : *design_scope->Modules()) {
+      children.push_back({StripWorklib(sub->VpiName()), sub});
+    }
+  }
+  if (design_scope->Gen_scope_arrays() != nullptr) {
+    for (const auto *ga : *design_scope->Gen_scope_arrays()) {
+      if (ga->Gen_scopes() == nullptr || ga->Gen_scopes()->empty()) continue;
+      children.push_back({StripWorklib(ga->VpiName()), (*ga->Gen_scopes())[0]});
+    }
+  }
+  absl::flat_hash_map<std::string_view, const UHDM::any *> children_by_name;
+  for (const auto &[name, child] : children) {
+    children_by_name.emplace(name, child);
+  }
+  for (const auto &signal_sub : signal_scope->children) {
+    const UHDM::any *design_sub = find(children_by_name, signal_sub.name);
+    // Fall back to the looser match that the names might need.
+    for (int i = 0; design_sub == nullptr && i < children.size(); ++i) {
+      if (ScopeMatch(children[i].first, signal_sub.name)) {
+        design_sub = children[i].second;
+      }
+    }
+    if (design_sub != nullptr) AddScope(design_sub, &signal_sub);
+  }
+}
+
+std::vector<const WaveData::Signal *>
+DesignSignalMap::Signals(const UHDM::any *item) const {
+  if (item != nullptr && item->VpiType() == vpiRefObj) {
+    item = dynamic_cast<const UHDM::ref_obj *>(item)->Actual_group();
+  }
+  const auto it = signals_.find(item);
+  if (it == signals_.end()) return {};
+  return it->second;
+}
+
+const UHDM::any *
+DesignSignalMap::DesignItem(const WaveData::Signal *signal) const {
+  const auto it = design_items_.find(signal);
+  return it == design_items_.end() ? nullptr : it->second;
+}
+
+} // namespace sv
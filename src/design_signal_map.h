@@ -0,0 +1,45 @@
+#pragma once
+
+#include "absl/container/flat_hash_map.h"
+#include "wave_data.h"
+#include <vector>
+
+namespace UHDM {
+class any;
+} // namespace UHDM
+
+namespace sv {
+
+// Which wave signals hold the values of which nets and variables of the
+// design, and the other way around. The design hierarchy is joined with the
+// wave hierarchy once, starting from a pair of scopes that correspond to each
+// other, so that looking either way up is a hash lookup.
+//
+// Nets and variables match the signal of the same name. Arrays also match the
+// signals of their elements, which have a [n] suffix, and so do the vectors
+// that are split into one signal per bit in the waves.
+class DesignSignalMap {
+ public:
+  DesignSignalMap() = default;
+  DesignSignalMap(const UHDM::any *design_scope,
+                  const WaveData::SignalScope *signal_scope);
+  // The signals of a net or variable, or of the one a reference is to.
+  std::vector<const WaveData::Signal *> Signals(const UHDM::any *item) const;
+  // The net or variable of a signal, or nullptr if there is none.
+  const UHDM::any *DesignItem(const WaveData::Signal *signal) const;
+
+ private:
+  // Joins a module or generate scope.
+  void AddScope(const UHDM::any *design_scope,
+                const WaveData::SignalScope *signal_scope);
+  template <typename T>
+  void AddScope(const T *design_scope,
+                const WaveData::SignalScope *signal_scope);
+
+  absl::flat_hash_map<const UHDM::any *, std::vector<const WaveData::Signal *>>
+      signals_;
+  absl::flat_hash_map<const WaveData::Signal *, const UHDM::any *>
+      design_items_;
+};
+
+} // namespace sv
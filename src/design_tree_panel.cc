@@ -48,24 +48,33 @@ void DesignTreePanel::SetItem(const UHDM::any *item) {
     }
     item = item->VpiParent();
   }
-  // Now look through the list at every level and expand as necessary.
-  // Iterate backwards so that the root is the first thing looked for.
+  // Now look for each of them among the children of the one found before,
+  // and expand that one when it is. Iterate backwards so that the root is the
+  // first thing looked for. Items that aren't in the tree are skipped.
+  int found_idx = -1;
   for (int path_idx = path.size() - 1; path_idx >= 0; --path_idx) {
     auto &path_item = path[path_idx];
-    for (int item_idx = 0; item_idx < data_.ListSize(); ++item_idx) {
-      const auto *list_item =
-          dynamic_cast<const DesignTreeItem *>(data_[item_idx]);
-      if (path_item == list_item->DesignItem()) {
-        line_idx_ = item_idx;
-        // Expand the item if it isn't already, and if it isn't the last one.
-        if (list_item->Expandable() && !list_item->Expanded() &&
-            path_idx != 0) {
-          data_.ToggleExpand(item_idx);
+    if (found_idx < 0) {
+      for (int i = 0; i < roots_.size(); ++i) {
+        if (path_item == roots_[i]->DesignItem()) {
+          found_idx = data_.RootIdx(i);
+          break;
         }
+      }
+      continue;
+    }
+    auto *parent = data_[found_idx];
+    for (int i = 0; i < parent->NumChildren(); ++i) {
+      const auto *child =
+          dynamic_cast<const DesignTreeItem *>(parent->Child(i));
+      if (path_item == child->DesignItem()) {
+        if (!parent->Expanded()) data_.ToggleExpand(found_idx);
+        found_idx = data_.ChildIdx(found_idx, i);
         break;
       }
     }
   }
+  if (found_idx >= 0) line_idx_ = found_idx;
   SetLineAndScroll(line_idx_);
 }
 
@@ -1,17 +1,19 @@
 #include "fst_wave_data.h"
 #include "external/fst/fstapi.h"
-#include <stack>
+#include "utils.h"
+#include <algorithm>
 #include <stdexcept>
+#include <thread>
 
 namespace sv {
 namespace {
 
-std::string ParseSignalLsb(const std::string &s, int *lsb) {
+std::string_view ParseSignalLsb(std::string_view s, int *lsb) {
   auto range_pos = s.find_last_of('[');
   auto colon_pos = s.find_last_of(':');
   if (range_pos != std::string::npos && colon_pos != std::string::npos &&
       range_pos < colon_pos) {
-    *lsb = std::stoi(s.substr(colon_pos + 1));
+    *lsb = std::stoi(std::string(s.substr(colon_pos + 1)));
     while (range_pos > 0 && s[range_pos - 1] == ' ') {
       range_pos--;
     }
@@ -32,58 +34,58 @@ FstWaveData::FstWaveData(const std::string &file_name, bool keep_glitches)
   ReadScopes();
 }
 
-FstWaveData::~FstWaveData() { fstReaderClose(reader_); }
+FstWaveData::~FstWaveData() {
+  fstReaderClose(reader_);
+  for (void *reader : readers_) {
+    fstReaderClose(reader);
+  }
+  if (value_reader_ != nullptr) fstReaderClose(value_reader_);
+}
 
 int FstWaveData::Log10TimeUnits() const {
   return fstReaderGetTimescale(reader_);
 }
 
 void FstWaveData::ReadScopes() {
-  std::stack<SignalScope *> stack;
+  value_sizes_.assign(fstReaderGetMaxHandle(reader_) + 1, 0);
   fstHier *h;
   while ((h = fstReaderIterateHier(reader_))) {
     switch (h->htyp) {
-    case FST_HT_SCOPE: {
-      std::string name(h->u.scope.name, h->u.scope.name_length);
-      if (stack.empty()) {
-        // A root node just needs the name.
-        SignalScope root;
-        root.name = name;
-        roots_.push_back(root);
-        // This can be safely done since the roots vector won't be modified
-        // until the stack is empty.
-        stack.push(&roots_.back());
-      } else {
-        stack.top()->children.push_back({});
-        stack.top()->children.back().name = name;
-        stack.push(&stack.top()->children.back());
-      }
-    } break;
-    case FST_HT_UPSCOPE: stack.pop(); break;
+    case FST_HT_SCOPE:
+      BeginScope(std::string_view(h->u.scope.name, h->u.scope.name_length));
+      break;
+    case FST_HT_UPSCOPE: EndScope(); break;
     case FST_HT_VAR: {
-      std::string name(h->u.var.name, h->u.var.name_length);
-      stack.top()->signals.push_back({});
-      auto &signal = stack.top()->signals.back();
-      signal.id = h->u.var.handle;
-      signal.width = h->u.var.length;
-      signal.name = ParseSignalLsb(name, &signal.lsb);
+      int lsb = 0;
+      const std::string_view name = ParseSignalLsb(
+          std::string_view(h->u.var.name, h->u.var.name_length), &lsb);
+      Signal *signal = AddSignal(name);
+      if (signal == nullptr) break;
+      signal->id = h->u.var.handle;
+      signal->width = h->u.var.length;
+      signal->lsb = lsb;
       switch (h->u.var.direction) {
-      case FST_VD_IMPLICIT: signal.direction = Signal::kInternal; break;
-      case FST_VD_INOUT: signal.direction = Signal::kInout; break;
-      case FST_VD_INPUT: signal.direction = Signal::kInput; break;
-      case FST_VD_OUTPUT: signal.direction = Signal::kOutput; break;
+      case FST_VD_IMPLICIT: signal->direction = Signal::kInternal; break;
+      case FST_VD_INOUT: signal->direction = Signal::kInout; break;
+      case FST_VD_INPUT: signal->direction = Signal::kInput; break;
+      case FST_VD_OUTPUT: signal->direction = Signal::kOutput; break;
       }
       if (h->u.var.typ == FST_VT_VCD_PARAMETER) {
-        signal.type = Signal::kParameter;
+        signal->type = Signal::kParameter;
+      }
+      // Real values are passed as text, everything else as one character per
+      // bit.
+      const bool real = h->u.var.typ == FST_VT_VCD_REAL ||
+                        h->u.var.typ == FST_VT_VCD_REAL_PARAMETER ||
+                        h->u.var.typ == FST_VT_VCD_REALTIME ||
+                        h->u.var.typ == FST_VT_SV_SHORTREAL;
+      if (!h->u.var.is_alias && !real && signal->id < value_sizes_.size()) {
+        value_sizes_[signal->id] = h->u.var.length;
       }
     } break;
     }
   }
-  // Now that everything has been read and allocated, recurse the tree and fill
-  // in parents. Can't do this on the fly since vectors get re-allocated and
-  // shuffled around, so pointers derived there won't necessarily be correct
-  // after wave data reading is finished.
-  BuildParents();
+  FinishHierarchy();
 }
 
 std::pair<uint64_t, uint64_t> FstWaveData::TimeRange() const {
@@ -93,77 +95,159 @@ std::pair<uint64_t, uint64_t> FstWaveData::TimeRange() const {
   return range;
 }
 
-void FstWaveData::LoadSignalSamples(const std::vector<const Signal *> &signals,
-                                    uint64_t start_time,
-                                    uint64_t end_time) const {
-  // Build a map to know where each result goes during the unpredictable order
-  // in callbacks.
-  fstReaderClrFacProcessMaskAll(reader_);
+void FstWaveData::ReadBlocks(void *reader,
+                             const std::vector<const Signal *> &signals,
+                             uint64_t start_time, uint64_t end_time,
+                             WaveMap *waves) const {
+  fstReaderClrFacProcessMaskAll(reader);
+  // Callbacks come in an unpredictable order, keep track of where each result
+  // goes. The callback runs for every single value change, so this is a flat
+  // table: handles are dense, from 1 through the max handle.
+  ReadState state;
+  state.stores.resize(value_sizes_.size(), nullptr);
+  state.value_sizes = value_sizes_.data();
+  state.keep_glitches = keep_glitches_;
   for (const auto &s : signals) {
-    if (s == nullptr) continue;
-    // Don't re-read existing waves.
-    if (s->valid_start_time <= start_time && s->valid_end_time >= end_time) {
-      continue;
-    }
-    waves_[s->id].clear();
-    // Save the time over where the samples are valid.
-    s->valid_start_time = start_time;
-    s->valid_end_time = end_time;
+    (*waves)[s->id] = SampleStore(s->width);
+  }
+  // Only now that the map is complete, the stores stay in place.
+  for (const auto &s : signals) {
+    if (s->id >= state.stores.size()) continue;
+    state.stores[s->id] = &(*waves)[s->id];
     // Tell the reader to include this signal while reading the large data
     // blocks.
-    fstReaderSetFacProcessMask(reader_, s->id);
+    fstReaderSetFacProcessMask(reader, s->id);
   }
 
   // This is more of a hint, data blocks can read data outside these limits.
-  fstReaderSetLimitTimeRange(reader_, start_time, end_time);
+  fstReaderSetLimitTimeRange(reader, start_time, end_time);
 
   fstReaderIterBlocks(
-      reader_,
+      reader,
       +[](void *user_callback_data_pointer, uint64_t time, fstHandle facidx,
           const unsigned char *value) {
-        FstWaveData *fst =
-            reinterpret_cast<FstWaveData *>(user_callback_data_pointer);
-        std::vector<Sample> &samples = fst->waves_[facidx];
-        const char *str_val = reinterpret_cast<const char *>(value);
-        if (!fst->keep_glitches_ && !samples.empty()) {
-          Sample &prev_sample = samples.back();
-          if (str_val == prev_sample.value) {
-            return; // Ignore duplicates.
-          } else if (time == prev_sample.time) {
-            // Does this new value make the previous one pointless?
-            if (samples.size() > 1 &&
-                samples[samples.size() - 2].value == str_val) {
-              samples.pop_back();
-            } else {
-              // Just update the previous with this new value.
-              prev_sample.value = str_val;
-            }
-            return;
-          }
-        }
-        samples.push_back({.time = time, .value = str_val});
+        auto *state = reinterpret_cast<ReadState *>(user_callback_data_pointer);
+        const char *chars = reinterpret_cast<const char *>(value);
+        const uint32_t size = state->value_sizes[facidx];
+        state->stores[facidx]->Add(time,
+                                   size == 0 ? std::string_view(chars)
+                                             : std::string_view(chars, size),
+                                   state->keep_glitches);
       },
-      const_cast<FstWaveData *>(this), nullptr);
+      &state, nullptr);
+}
 
-  // Update the valid range based on sample data actually received.
-  for (const auto &s : signals) {
-    if (s == nullptr) continue;
-    auto &wave = waves_[s->id];
-    if (wave.empty()) continue;
-    s->valid_start_time = std::min(s->valid_start_time, wave.front().time);
-    s->valid_end_time = std::max(s->valid_end_time, wave.back().time);
+uint64_t FstWaveData::ReadSignalSamples(
+    const std::vector<const Signal *> &signals, uint64_t start_time,
+    uint64_t end_time, WaveMap *waves) const {
+  // The readers keep state between calls.
+  std::lock_guard<std::mutex> lock(reader_mutex_);
+  // Value change sections are decompressed as a whole, so it only pays off to
+  // spread the time range over several readers if it spans multiple sections.
+  const auto [first_time, last_time] = TimeRange();
+  const uint64_t read_start = std::max(start_time, first_time);
+  const uint64_t read_end = std::min(end_time, last_time);
+  int num_parts = std::min<uint64_t>(
+      {std::max(1u, std::thread::hardware_concurrency()),
+       fstReaderGetValueChangeSectionCount(reader_),
+       read_end >= read_start ? read_end - read_start + 1 : 1});
+  while (readers_.size() + 1 < num_parts) {
+    void *reader = fstReaderOpen(file_name_.c_str());
+    if (reader == nullptr) break;
+    readers_.push_back(reader);
+  }
+  num_parts = std::min<int>(num_parts, readers_.size() + 1);
+  if (num_parts <= 1) {
+    ReadBlocks(reader_, signals, start_time, end_time, waves);
+    return end_time;
   }
+  // Each reader covers a slice of the time range. The sections that straddle
+  // the boundaries are read by both neighbours, and each reader starts with
+  // the values at the start of its first section, so the slices overlap a
+  // bit. That is taken care of while merging them.
+  std::vector<WaveMap> parts(num_parts);
+  const uint64_t part_size = (read_end - read_start) / num_parts + 1;
+  ParallelFor(num_parts, [&](int i) {
+    const uint64_t part_start = read_start + i * part_size;
+    if (part_start > read_end) return;
+    const uint64_t part_end = std::min(read_end, part_start + part_size - 1);
+    ReadBlocks(i == 0 ? reader_ : readers_[i - 1], signals, part_start,
+               part_end, &parts[i]);
+  });
+  for (int i = 0; i < num_parts; ++i) {
+    // Everything before the part's own time range was read by the others.
+    const uint64_t covered_time = i == 0 ? 0 : read_start + i * part_size - 1;
+    for (auto &[id, samples] : parts[i]) {
+      (*waves)[id].Extend(std::move(samples), covered_time, keep_glitches_);
+    }
+    // Release memory as soon as possible.
+    parts[i].clear();
+  }
+  return end_time;
+}
+
+std::vector<std::string> FstWaveData::ReadSignalValues(
+    const std::vector<const Signal *> &signals, uint64_t time) const {
+  if (value_reader_ == nullptr) {
+    value_reader_ = fstReaderOpen(file_name_.c_str());
+    if (value_reader_ == nullptr) {
+      return WaveData::ReadSignalValues(signals, time);
+    }
+    // Room for the widest value, and for reals printed as text.
+    const uint32_t max_size =
+        *std::max_element(value_sizes_.begin(), value_sizes_.end());
+    value_buffer_.resize(std::max<uint32_t>(max_size, 64) + 1);
+  }
+  std::vector<std::string> values(signals.size());
+  std::vector<const Signal *> unread;
+  std::vector<int> unread_idx;
+  for (int i = 0; i < signals.size(); ++i) {
+    // Only decodes the value change section containing the time, and only
+    // when it differs from the one of the previous query.
+    const char *value = fstReaderGetValueFromHandleAtTime(
+        value_reader_, time, signals[i]->id, value_buffer_.data());
+    if (value == nullptr) {
+      // Variable length values, or times outside of the sections.
+      unread.push_back(signals[i]);
+      unread_idx.push_back(i);
+      continue;
+    }
+    // Reals can come back with the VCD prefix.
+    if (value[0] == 'r') value++;
+    // Normalize the same way as loaded waves.
+    SampleStore sample(signals[i]->width);
+    sample.Add(time, value, keep_glitches_);
+    values[i] = sample.Value(0);
+  }
+  if (!unread.empty()) {
+    std::vector<std::string> read_values =
+        WaveData::ReadSignalValues(unread, time);
+    for (int i = 0; i < unread.size(); ++i) {
+      values[unread_idx[i]] = std::move(read_values[i]);
+    }
+  }
+  return values;
 }
 
 void FstWaveData::Reload() {
-  // First, re-create the reader.
+  // First, re-create the reader. The extra ones are re-opened when needed.
+  // Not while a read is still using them.
+  std::lock_guard<std::mutex> lock(reader_mutex_);
   fstReaderClose(reader_);
+  for (void *reader : readers_) {
+    fstReaderClose(reader);
+  }
+  readers_.clear();
+  if (value_reader_ != nullptr) {
+    fstReaderClose(value_reader_);
+    value_reader_ = nullptr;
+  }
   reader_ = fstReaderOpen(file_name_.c_str());
   if (reader_ == nullptr) {
     throw std::runtime_error("Unable to read wave file.");
   }
   waves_.clear();
-  roots_.clear();
+  ClearHierarchy();
   ReadScopes();
 }
 
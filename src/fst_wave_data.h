@@ -1,6 +1,7 @@
 #pragma once
 
 #include "wave_data.h"
+#include <mutex>
 
 namespace sv {
 
@@ -11,14 +12,41 @@ class FstWaveData : public WaveData {
   ~FstWaveData() override;
   int Log10TimeUnits() const final;
   std::pair<uint64_t, uint64_t> TimeRange() const final;
-  void LoadSignalSamples(const std::vector<const Signal *> &signals,
-                         uint64_t start_time, uint64_t end_time) const final;
+  uint64_t ReadSignalSamples(const std::vector<const Signal *> &signals,
+                             uint64_t start_time, uint64_t end_time,
+                             WaveMap *waves) const final;
+  std::vector<std::string> ReadSignalValues(
+      const std::vector<const Signal *> &signals,
+      uint64_t time) const final;
   void Reload() final;
 
  private:
   void ReadScopes();
+  // Reads the samples of the signals with one of the reader contexts.
+  void ReadBlocks(void *reader, const std::vector<const Signal *> &signals,
+                  uint64_t start_time, uint64_t end_time,
+                  WaveMap *waves) const;
   // The FST library is written in C and uses a lot of untyped handles.
   void *reader_ = nullptr;
+  // Additional reader contexts, to decompress value change sections in
+  // parallel. Opened as they are needed.
+  mutable std::vector<void *> readers_;
+  mutable std::mutex reader_mutex_;
+  // Reader context for point queries. The FST library keeps the value change
+  // section of the last query decoded in there, so it isn't shared with the
+  // block reads above. Opened on first use.
+  mutable void *value_reader_ = nullptr;
+  mutable std::vector<char> value_buffer_;
+  // Destination of the samples while iterating the data blocks.
+  struct ReadState {
+    // Indexed by handle, null for the ones not read.
+    std::vector<SampleStore *> stores;
+    const uint32_t *value_sizes;
+    bool keep_glitches;
+  };
+  // Length of the values the reader passes for each handle, or zero if they
+  // are null terminated text.
+  std::vector<uint32_t> value_sizes_;
 };
 
 } // namespace sv
@@ -1,7 +1,10 @@
 #include "ui.h"
+#include "utils.h"
+#include "vcd_wave_data.h"
 #include "workspace.h"
 #include <cstring>
 #include <iostream>
+#include <thread>
 
 int main(int argc, char *argv[]) {
   if (argc < 2) {
@@ -18,6 +21,19 @@ int main(int argc, char *argv[]) {
   for (int i = 0; i < argc; ++i) {
     if (strcmp(argv[i], "-keep_glitches") == 0) {
       keep_glitches = true;
+    } else if (strcmp(argv[i], "-no_wave_cache") == 0) {
+      sv::VcdWaveData::UseCache(false);
+    } else if (strcmp(argv[i], "-no_design_cache") == 0) {
+      sv::Workspace::UseDesignCache(false);
+    } else if (strcmp(argv[i], "-wave_mem_limit") == 0) {
+      std::optional<uint64_t> limit;
+      if (i < argc - 1) limit = sv::ParseMemorySize(argv[i + 1]);
+      if (!limit) {
+        std::cout << "Missing or bad memory limit, expected e.g. 4G.\n";
+        return -1;
+      }
+      sv::WaveData::SetMemoryLimit(*limit);
+      i++;
     } else if (strcmp(argv[i], "-waves") == 0) {
       if (i == argc - 1) {
         std::cout << "Missing wave file argument.\n";
@@ -32,24 +48,31 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  // Read the waves on a separate thread while the design is parsed. The two
+  // don't depend on each other until they are matched up.
+  bool waves_ok = true;
+  std::thread wave_thread;
+  if (!wave_file.empty()) {
+    std::cout << "Reading wave file...\n";
+    wave_thread = std::thread([&] {
+      waves_ok = sv::Workspace::Get().ReadWaves(wave_file, keep_glitches);
+    });
+  }
+
   // Parse the design using the remaining command line arguments
+  bool design_ok = true;
   if (pruned_args.size() > 1) {
-    // TODO: Run in parallel threads with wave parsing?
     std::cout << "Parsing design files...\n";
-    if (!sv::Workspace::Get().ParseDesign(
-            pruned_args.size(),
-            const_cast<const char **>(pruned_args.data()))) {
-      // This function prints plenty of errors if it fails.
-      return -1;
-    }
+    design_ok = sv::Workspace::Get().ParseDesign(
+        pruned_args.size(), const_cast<const char **>(pruned_args.data()));
   }
 
-  if (!wave_file.empty()) {
-    std::cout << "Reading wave file...\n";
-    if (!sv::Workspace::Get().ReadWaves(wave_file, keep_glitches)) {
-      std::cout << "Problem reading wave file.\n";
-      return -1;
-    }
+  if (wave_thread.joinable()) wave_thread.join();
+  // ParseDesign prints plenty of errors if it fails.
+  if (!design_ok) return -1;
+  if (!waves_ok) {
+    std::cout << "Problem reading wave file.\n";
+    return -1;
   }
 
   // Try to match the two up.
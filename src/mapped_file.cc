@@ -0,0 +1,39 @@
+#include "mapped_file.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sv {
+
+MappedFile::MappedFile(const std::string &file_name, bool sequential_access) {
+  const int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open " + file_name);
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    throw std::runtime_error("Unable to stat " + file_name);
+  }
+  size_ = st.st_size;
+  // Zero-length mappings are not allowed, but an empty file is still valid.
+  if (size_ > 0) {
+    void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Unable to map " + file_name);
+    }
+    if (sequential_access) madvise(p, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *>(p);
+  }
+  // The mapping stays valid after the descriptor is closed.
+  close(fd);
+}
+
+MappedFile::~MappedFile() {
+  if (data_ != nullptr) munmap(const_cast<char *>(data_), size_);
+}
+
+} // namespace sv
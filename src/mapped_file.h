@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace sv {
+
+// Read-only memory mapping of an entire file. The contents are paged in by the
+// kernel on demand, so even very large files can be "opened" instantly and
+// scanned at memory bandwidth without going through stream buffers.
+class MappedFile {
+ public:
+  // Throws std::runtime_error if the file can't be opened or mapped. A hint
+  // can be given that the file is going to be read front to back, which
+  // enables more aggressive read-ahead.
+  explicit MappedFile(const std::string &file_name,
+                      bool sequential_access = false);
+  ~MappedFile();
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  std::string_view Data() const { return {data_, size_}; }
+  uint64_t Size() const { return size_; }
+
+ private:
+  const char *data_ = nullptr;
+  uint64_t size_ = 0;
+};
+
+} // namespace sv
@@ -0,0 +1,540 @@
+#include "sample_store.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace sv {
+namespace {
+
+constexpr char kCodeChars[] = "01xz";
+
+// Reads n <= 64 bits starting at bit position pos.
+uint64_t ReadBits(const std::vector<uint64_t> &plane, uint64_t pos, int n) {
+  const uint64_t word = pos / 64;
+  const int shift = pos % 64;
+  uint64_t v = plane[word] >> shift;
+  if (shift + n > 64) v |= plane[word + 1] << (64 - shift);
+  return n == 64 ? v : v & ((1ull << n) - 1);
+}
+
+// Writes n <= 64 bits starting at bit position pos.
+void WriteBits(std::vector<uint64_t> *plane, uint64_t pos, int n, uint64_t v) {
+  const uint64_t word = pos / 64;
+  const int shift = pos % 64;
+  const uint64_t mask = n == 64 ? ~0ull : (1ull << n) - 1;
+  v &= mask;
+  (*plane)[word] = ((*plane)[word] & ~(mask << shift)) | (v << shift);
+  if (shift + n > 64) {
+    const int written = 64 - shift;
+    (*plane)[word + 1] =
+        ((*plane)[word + 1] & ~(mask >> written)) | (v >> written);
+  }
+}
+
+uint64_t WordsForBits(uint64_t bits) { return (bits + 63) / 64; }
+
+int CharToCode(char c) {
+  switch (c) {
+  case '1': return 1;
+  case 'x':
+  case 'X': return 2;
+  case 'z':
+  case 'Z': return 3;
+  default: return 0;
+  }
+}
+
+int OffsetSizeFor(uint64_t offset) {
+  if (offset <= UINT8_MAX) return 1;
+  if (offset <= UINT16_MAX) return 2;
+  if (offset <= UINT32_MAX) return 4;
+  return 8;
+}
+
+uint64_t ReadOffset(const uint8_t *p, int size) {
+  switch (size) {
+  case 1: return *p;
+  case 2: {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  case 4: {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  default: {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+  }
+  }
+}
+
+void WriteOffset(uint8_t *p, int size, uint64_t offset) {
+  switch (size) {
+  case 1: *p = offset; break;
+  case 2: {
+    const uint16_t v = offset;
+    memcpy(p, &v, sizeof(v));
+    break;
+  }
+  case 4: {
+    const uint32_t v = offset;
+    memcpy(p, &v, sizeof(v));
+    break;
+  }
+  default: memcpy(p, &offset, sizeof(offset)); break;
+  }
+}
+
+// Character at position pos of a logic value extended to the given width.
+char ExtendedChar(std::string_view value, int width, int pos) {
+  const int pad = width - static_cast<int>(value.size());
+  if (pos >= pad) return value[pos - pad];
+  if (value.empty()) return '0';
+  const char msb = std::tolower(value[0]);
+  return msb == 'x' || msb == 'z' ? msb : '0';
+}
+
+} // namespace
+
+SampleStore::SampleStore(int width) : width_(std::max(1, width)) {}
+
+uint64_t SampleStore::Time(int idx) const {
+  const TimeBlock &block = blocks_[idx / kBlockSize];
+  const uint8_t *p = &time_bytes_[block.byte_offset +
+                                  (idx % kBlockSize) * block.offset_size];
+  return block_times_[idx / kBlockSize] + ReadOffset(p, block.offset_size);
+}
+
+int SampleStore::FindIndex(uint64_t time, int hint) const {
+  if (size_ == 0) return -1;
+  hint = std::clamp(hint, 0, size_ - 1);
+  if (Time(hint) > time) return hint;
+  int lo = hint;
+  int hi;
+  if (hint == 0) {
+    // Without a hint, find the block first. Later blocks start after the time,
+    // so the result is in this one.
+    const auto it =
+        std::upper_bound(block_times_.begin(), block_times_.end(), time);
+    lo = std::max<int>(0, it - block_times_.begin() - 1) * kBlockSize;
+    hi = std::min(size_, lo + kBlockSize);
+  } else {
+    // Gallop forward, doubling the step, until past the time.
+    int step = 1;
+    hi = lo + step;
+    while (hi < size_ && Time(hi) <= time) {
+      lo = hi;
+      step *= 2;
+      hi = lo + step;
+    }
+    hi = std::min(hi, size_);
+  }
+  // Time(lo) <= time, and Time(hi) > time if it exists.
+  while (hi - lo > 1) {
+    const int mid = lo + (hi - lo) / 2;
+    if (Time(mid) <= time) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+int SampleStore::Code(int idx, int bit) const {
+  const uint64_t pos = static_cast<uint64_t>(idx) * width_ + bit;
+  if (encoding_ == Encoding::kTwoState) return ReadBits(plane_, pos, 1);
+  return ReadBits(plane_, 2 * pos, 2);
+}
+
+std::string SampleStore::Value(int idx) const {
+  if (encoding_ == Encoding::kText) {
+    return text_.substr(text_offsets_[idx],
+                        text_offsets_[idx + 1] - text_offsets_[idx]);
+  }
+  std::string s(width_, '0');
+  for (int bit = 0; bit < width_; ++bit) {
+    s[width_ - 1 - bit] = kCodeChars[Code(idx, bit)];
+  }
+  return s;
+}
+
+char SampleStore::Bit(int idx, int pos) const {
+  if (encoding_ == Encoding::kText) {
+    const uint64_t offset = text_offsets_[idx] + pos;
+    return offset < text_offsets_[idx + 1] ? text_[offset] : 'x';
+  }
+  if (pos < 0 || pos >= width_) return 'x';
+  return kCodeChars[Code(idx, width_ - 1 - pos)];
+}
+
+int SampleStore::BitTransitions(int first, int last, int pos,
+                                int max_count) const {
+  int count = 0;
+  for (int i = first + 1; i <= last && count < max_count; ++i) {
+    if (Bit(i - 1, pos) != Bit(i, pos)) count++;
+  }
+  return count;
+}
+
+uint8_t SampleStore::Flags(int idx) const {
+  if (encoding_ == Encoding::kTwoState) return 0;
+  if (encoding_ == Encoding::kText) {
+    const std::string value = Value(idx);
+    return (value.find('x') != std::string::npos ? kFlagX : 0) |
+           (value.find('z') != std::string::npos ? kFlagZ : 0);
+  }
+  // Two bits per signal bit, x being 0b10 and z 0b11.
+  uint8_t flags = 0;
+  const uint64_t start = 2ull * idx * width_;
+  for (int done = 0; done < 2 * width_; done += 64) {
+    const int n = std::min(64, 2 * width_ - done);
+    const uint64_t w = ReadBits(plane_, start + done, n);
+    if ((w & ~(w << 1)) & 0xAAAAAAAAAAAAAAAAull) flags |= kFlagX;
+    if ((w & (w << 1)) & 0xAAAAAAAAAAAAAAAAull) flags |= kFlagZ;
+  }
+  return flags;
+}
+
+void SampleStore::FindXZ(int first, int last, bool *has_x,
+                         bool *has_z) const {
+  *has_x = false;
+  *has_z = false;
+  if (encoding_ == Encoding::kTwoState || first > last) return;
+  // Walk up the summary levels, only looking at the partially covered entries
+  // at either end of the range on each level.
+  uint8_t flags = 0;
+  uint64_t lo = first;
+  uint64_t hi = static_cast<uint64_t>(last) + 1;
+  auto entry = [&](int level, uint64_t i) {
+    return level == 0 ? Flags(i) : summary_[level - 1][i];
+  };
+  for (int level = 0; lo < hi; ++level) {
+    if (hi - lo <= kBlockSize || level == summary_.size()) {
+      for (uint64_t i = lo; i < hi; ++i) {
+        flags |= entry(level, i);
+      }
+      break;
+    }
+    while (lo % kBlockSize != 0) {
+      flags |= entry(level, lo++);
+    }
+    while (hi % kBlockSize != 0) {
+      flags |= entry(level, --hi);
+    }
+    lo /= kBlockSize;
+    hi /= kBlockSize;
+  }
+  *has_x = flags & kFlagX;
+  *has_z = flags & kFlagZ;
+}
+
+uint64_t SampleStore::MemoryUsage() const {
+  uint64_t bytes = blocks_.capacity() * sizeof(TimeBlock) +
+                   block_times_.capacity() * sizeof(uint64_t) +
+                   time_bytes_.capacity() +
+                   plane_.capacity() * sizeof(uint64_t) + text_.capacity() +
+                   text_offsets_.capacity() * sizeof(uint64_t) +
+                   value_scratch_.capacity() * sizeof(uint64_t);
+  for (const auto &level : summary_) {
+    bytes += level.capacity();
+  }
+  return bytes;
+}
+
+void SampleStore::AddToSummary(int idx) {
+  if (encoding_ == Encoding::kTwoState) return;
+  const uint8_t flags = Flags(idx);
+  uint64_t entry = idx;
+  for (auto &level : summary_) {
+    entry /= kBlockSize;
+    if (level.size() <= entry) level.push_back(0);
+    level[entry] |= flags;
+  }
+  AddSummaryLevels();
+}
+
+void SampleStore::UpdateSummary(int idx) {
+  if (encoding_ == Encoding::kTwoState) return;
+  // Recompute the entries covering idx from the level below, dropping the
+  // ones that no longer cover anything.
+  uint64_t below_size = size_;
+  uint64_t entry = idx;
+  for (int level = 0; level < summary_.size(); ++level) {
+    entry /= kBlockSize;
+    const uint64_t size = (below_size + kBlockSize - 1) / kBlockSize;
+    summary_[level].resize(size);
+    if (entry < size) {
+      uint8_t flags = 0;
+      const uint64_t end = std::min(below_size, (entry + 1) * kBlockSize);
+      for (uint64_t i = entry * kBlockSize; i < end; ++i) {
+        flags |= level == 0 ? Flags(i) : summary_[level - 1][i];
+      }
+      summary_[level][entry] = flags;
+    }
+    below_size = size;
+  }
+}
+
+void SampleStore::RebuildSummary() {
+  summary_.clear();
+  if (encoding_ == Encoding::kTwoState) return;
+  summary_.emplace_back((size_ + kBlockSize - 1) / kBlockSize, 0);
+  for (int i = 0; i < size_; ++i) {
+    summary_[0][i / kBlockSize] |= Flags(i);
+  }
+  AddSummaryLevels();
+}
+
+void SampleStore::AddSummaryLevels() {
+  while (summary_.back().size() > kBlockSize) {
+    const auto &below = summary_.back();
+    std::vector<uint8_t> level((below.size() + kBlockSize - 1) / kBlockSize);
+    for (uint64_t i = 0; i < below.size(); ++i) {
+      level[i / kBlockSize] |= below[i];
+    }
+    summary_.push_back(std::move(level));
+  }
+}
+
+void SampleStore::PushTime(uint64_t time) {
+  if (size_ % kBlockSize == 0) {
+    block_times_.push_back(time);
+    blocks_.push_back({.byte_offset = time_bytes_.size(), .offset_size = 1});
+  }
+  TimeBlock &block = blocks_.back();
+  const int count = size_ % kBlockSize;
+  // Times are normally increasing, but wrap around otherwise.
+  const uint64_t offset = time - block_times_.back();
+  const int offset_size = OffsetSizeFor(offset);
+  if (offset_size > block.offset_size) {
+    // Widen the offsets in the last block, which is at the end of the buffer.
+    uint64_t offsets[kBlockSize];
+    for (int i = 0; i < count; ++i) {
+      offsets[i] = ReadOffset(&time_bytes_[block.byte_offset +
+                                           i * block.offset_size],
+                              block.offset_size);
+    }
+    block.offset_size = offset_size;
+    time_bytes_.resize(block.byte_offset + count * offset_size);
+    for (int i = 0; i < count; ++i) {
+      WriteOffset(&time_bytes_[block.byte_offset + i * offset_size],
+                  offset_size, offsets[i]);
+    }
+  }
+  time_bytes_.resize(time_bytes_.size() + block.offset_size);
+  WriteOffset(&time_bytes_[time_bytes_.size() - block.offset_size],
+              block.offset_size, offset);
+}
+
+void SampleStore::PopBack() {
+  size_--;
+  if (size_ % kBlockSize == 0) {
+    time_bytes_.resize(blocks_.back().byte_offset);
+    blocks_.pop_back();
+    block_times_.pop_back();
+  } else {
+    time_bytes_.resize(time_bytes_.size() - blocks_.back().offset_size);
+  }
+  if (encoding_ == Encoding::kText) {
+    text_offsets_.pop_back();
+    text_.resize(text_offsets_.back());
+  } else {
+    plane_.resize(WordsForBits(static_cast<uint64_t>(size_) *
+                               BitsPerSample()));
+  }
+  UpdateSummary(size_);
+}
+
+void SampleStore::SetEncoding(Encoding encoding) {
+  if (encoding == encoding_) return;
+  if (encoding == Encoding::kText) {
+    std::string text;
+    std::vector<uint64_t> text_offsets = {0};
+    for (int i = 0; i < size_; ++i) {
+      text += Value(i);
+      text_offsets.push_back(text.size());
+    }
+    text_ = std::move(text);
+    text_offsets_ = std::move(text_offsets);
+    plane_.clear();
+    plane_.shrink_to_fit();
+  } else {
+    // Two state to four state: every bit becomes a two bit code.
+    const uint64_t num_bits = static_cast<uint64_t>(size_) * width_;
+    std::vector<uint64_t> plane(WordsForBits(2 * num_bits));
+    for (uint64_t i = 0; i < num_bits; ++i) {
+      if (ReadBits(plane_, i, 1)) plane[2 * i / 64] |= 1ull << (2 * i % 64);
+    }
+    plane_ = std::move(plane);
+  }
+  encoding_ = encoding;
+  RebuildSummary();
+}
+
+void SampleStore::EncodeValue(std::string_view value) {
+  bool is_logic = true;
+  bool has_xz = false;
+  for (const char c : value) {
+    switch (c) {
+    case '0':
+    case '1': break;
+    case 'x':
+    case 'X':
+    case 'z':
+    case 'Z': has_xz = true; break;
+    default: is_logic = false; break;
+    }
+  }
+  if (!is_logic || value.empty()) {
+    SetEncoding(Encoding::kText);
+  } else if (has_xz && encoding_ == Encoding::kTwoState) {
+    SetEncoding(Encoding::kFourState);
+  }
+  if (encoding_ == Encoding::kText) return;
+  const int bits_per_code = encoding_ == Encoding::kFourState ? 2 : 1;
+  value_scratch_.assign(WordsForBits(BitsPerSample()), 0);
+  for (int bit = 0; bit < width_; ++bit) {
+    const uint64_t code =
+        CharToCode(ExtendedChar(value, width_, width_ - 1 - bit));
+    const int pos = bit * bits_per_code;
+    value_scratch_[pos / 64] |= code << (pos % 64);
+  }
+}
+
+bool SampleStore::ValueEquals(int idx, std::string_view value) const {
+  if (encoding_ == Encoding::kText) {
+    return std::string_view(text_).substr(text_offsets_[idx],
+                                          text_offsets_[idx + 1] -
+                                              text_offsets_[idx]) == value;
+  }
+  const int bits = BitsPerSample();
+  const uint64_t start = static_cast<uint64_t>(idx) * bits;
+  for (int done = 0; done < bits; done += 64) {
+    const int n = std::min(64, bits - done);
+    if (ReadBits(plane_, start + done, n) != value_scratch_[done / 64]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SampleStore::WriteValue(int idx, std::string_view value) {
+  if (encoding_ == Encoding::kText) {
+    // Only ever used on the last sample.
+    text_.resize(text_offsets_[idx]);
+    text_.append(value);
+    text_offsets_[idx + 1] = text_.size();
+    return;
+  }
+  const int bits = BitsPerSample();
+  const uint64_t start = static_cast<uint64_t>(idx) * bits;
+  for (int done = 0; done < bits; done += 64) {
+    const int n = std::min(64, bits - done);
+    WriteBits(&plane_, start + done, n, value_scratch_[done / 64]);
+  }
+}
+
+void SampleStore::PushValue(std::string_view value) {
+  if (encoding_ == Encoding::kText) {
+    text_.append(value);
+    text_offsets_.push_back(text_.size());
+  } else {
+    plane_.resize(
+        WordsForBits(static_cast<uint64_t>(size_ + 1) * BitsPerSample()));
+    WriteValue(size_, value);
+  }
+  size_++;
+  AddToSummary(size_ - 1);
+}
+
+void SampleStore::Add(uint64_t time, std::string_view value,
+                      bool keep_glitches) {
+  EncodeValue(value);
+  // Text samples of logic values are kept in the same form as Value() would
+  // return them in, so that they compare equal.
+  std::string text_value;
+  if (encoding_ == Encoding::kText &&
+      value.find_first_not_of("01xXzZ") == std::string_view::npos &&
+      !value.empty()) {
+    text_value.resize(width_);
+    for (int pos = 0; pos < width_; ++pos) {
+      text_value[pos] = std::tolower(ExtendedChar(value, width_, pos));
+    }
+    value = text_value;
+  }
+  if (!keep_glitches && size_ > 0) {
+    if (ValueEquals(size_ - 1, value)) {
+      return; // Ignore duplicates.
+    } else if (time == Time(size_ - 1)) {
+      // Does this new value make the previous one pointless?
+      if (size_ > 1 && ValueEquals(size_ - 2, value)) {
+        PopBack();
+      } else {
+        // Just update the previous with this new value.
+        WriteValue(size_ - 1, value);
+        UpdateSummary(size_ - 1);
+      }
+      return;
+    }
+  }
+  PushTime(time);
+  PushValue(value);
+}
+
+void SampleStore::Append(const SampleStore &other, bool keep_glitches,
+                         int first) {
+  if (first >= other.size_) return;
+  // Only the first sample can interact with the existing ones, the rest were
+  // already deduplicated among themselves.
+  Add(other.Time(first), other.Value(first), keep_glitches);
+  if (other.encoding_ > encoding_) SetEncoding(other.encoding_);
+  const int bits = BitsPerSample();
+  for (int i = first + 1; i < other.size_; ++i) {
+    PushTime(other.Time(i));
+    if (encoding_ == Encoding::kText) {
+      PushValue(other.Value(i));
+      continue;
+    }
+    plane_.resize(WordsForBits(static_cast<uint64_t>(size_ + 1) * bits));
+    const uint64_t dst = static_cast<uint64_t>(size_) * bits;
+    if (other.encoding_ == encoding_) {
+      const uint64_t src = static_cast<uint64_t>(i) * bits;
+      for (int done = 0; done < bits; done += 64) {
+        const int n = std::min(64, bits - done);
+        WriteBits(&plane_, dst + done, n,
+                  ReadBits(other.plane_, src + done, n));
+      }
+    } else {
+      for (int bit = 0; bit < width_; ++bit) {
+        WriteBits(&plane_, dst + 2 * bit, 2, other.Code(i, bit));
+      }
+    }
+    size_++;
+    AddToSummary(size_ - 1);
+  }
+}
+
+void SampleStore::Extend(SampleStore &&other, uint64_t covered_time,
+                         bool keep_glitches) {
+  if (empty()) {
+    *this = std::move(other);
+    return;
+  }
+  covered_time = std::max(covered_time, Time(size_ - 1));
+  int first = std::max(0, other.FindIndex(covered_time));
+  while (first < other.size_ && other.Time(first) <= covered_time) {
+    first++;
+  }
+  if (first == other.size_) return;
+  const bool initial_value = other.Time(first) == other.Time(0);
+  Append(other, keep_glitches && !initial_value, first);
+}
+
+void SampleStore::Clear() { *this = SampleStore(width_); }
+
+} // namespace sv
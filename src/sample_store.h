@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sv {
+
+// Compact, columnar storage for the samples (value changes) of a single wave.
+//
+// Times are kept in blocks of kBlockSize samples. Each block holds the time of
+// its first sample, and the offsets of all its samples from that time using the
+// smallest integer size that fits them all. The block start times are kept in
+// their own array, so that searches mostly stay within that small array.
+//
+// Values are kept in a packed bit plane with one bit per signal bit as long as
+// the wave only contains 0 and 1. The first x or z switches the wave to two
+// bits per signal bit. Values that aren't plain logic vectors at all, such as
+// reals or strings, switch the wave to text storage.
+//
+// A pyramid of per-block x/z flags is kept alongside, so that zoomed out
+// drawing can check large ranges of samples at once.
+class SampleStore {
+ public:
+  static constexpr int kBlockSize = 64;
+
+  explicit SampleStore(int width = 1);
+
+  int Width() const { return width_; }
+  int size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  uint64_t Time(int idx) const;
+  // Textual value of a sample, MSB first, with lower case x and z. Logic
+  // values always have Width() characters.
+  std::string Value(int idx) const;
+  // Returns the character at position pos of the textual value, MSB first,
+  // without building the whole string.
+  char Bit(int idx, int pos) const;
+  // Number of times the character at position pos changes from one sample to
+  // the next over [first, last], counting no further than max_count.
+  int BitTransitions(int first, int last, int pos, int max_count) const;
+  // Index of the last sample at or before the given time, or the first one if
+  // there is none, or -1 if the store is empty. The search can be started from
+  // a hint, which must not be past the result. It gallops forward from there,
+  // so that a sequence of searches for increasing times is cheap.
+  int FindIndex(uint64_t time, int hint = 0) const;
+  bool HasX(int idx) const { return Flags(idx) & kFlagX; }
+  bool HasZ(int idx) const { return Flags(idx) & kFlagZ; }
+  // Whether any of the samples in [first, last] has an x or z. A summary of
+  // blocks of samples is kept for this, so the cost doesn't grow with the
+  // number of samples in the range.
+  void FindXZ(int first, int last, bool *has_x, bool *has_z) const;
+  // Heap memory held by the store, in bytes.
+  uint64_t MemoryUsage() const;
+
+  // Adds a sample at the end. Logic values narrower than the width are
+  // extended as in VCD files: with x or z if that is the leftmost bit,
+  // otherwise with zeroes. Unless keep_glitches is set, values equal to the
+  // previous one are dropped, and multiple changes at the same time collapse
+  // to the last one.
+  void Add(uint64_t time, std::string_view value, bool keep_glitches);
+  // Adds the samples from another store of the same width, starting at index
+  // first, as if they were passed to Add() one by one. The other store must
+  // have been built with the same keep_glitches setting.
+  void Append(const SampleStore &other, bool keep_glitches, int first = 0);
+  // Continues the store with the samples of a read of a later time range,
+  // which can overlap what was read before: the samples of other up to
+  // covered_time, or the last sample already present, are skipped. Reads that
+  // skip ahead in a wave start with the values at that point, which aren't
+  // changes, so if the first new sample is one of those it's dropped when it
+  // repeats the last value, even when keeping glitches.
+  void Extend(SampleStore &&other, uint64_t covered_time, bool keep_glitches);
+  void Clear();
+
+ private:
+  enum class Encoding { kTwoState, kFourState, kText };
+  struct TimeBlock {
+    // Position of the first offset in time_bytes_.
+    uint64_t byte_offset;
+    // Size of each offset: 1, 2, 4 or 8.
+    int offset_size;
+  };
+
+  static constexpr uint8_t kFlagX = 1;
+  static constexpr uint8_t kFlagZ = 2;
+
+  int BitsPerSample() const {
+    return encoding_ == Encoding::kFourState ? 2 * width_ : width_;
+  }
+  // Bit code (0, 1, 2 = x, 3 = z) of a signal bit, 0 being the LSB.
+  int Code(int idx, int bit) const;
+  void PushTime(uint64_t time);
+  // Whether the sample has any x (kFlagX) or z (kFlagZ) bits.
+  uint8_t Flags(int idx) const;
+  // Keep the summary up to date after adding the last sample, or changing or
+  // removing it.
+  void AddToSummary(int idx);
+  void UpdateSummary(int idx);
+  void RebuildSummary();
+  // Adds coarser levels until the top one has at most kBlockSize entries.
+  void AddSummaryLevels();
+  void PopBack();
+  void SetEncoding(Encoding encoding);
+  // Prepares value_scratch_ with the packed form of the value, switching to a
+  // wider encoding first if needed.
+  void EncodeValue(std::string_view value);
+  bool ValueEquals(int idx, std::string_view value) const;
+  void WriteValue(int idx, std::string_view value);
+  void PushValue(std::string_view value);
+
+  int width_;
+  int size_ = 0;
+  Encoding encoding_ = Encoding::kTwoState;
+  std::vector<TimeBlock> blocks_;
+  // Time of the first sample in each block.
+  std::vector<uint64_t> block_times_;
+  std::vector<uint8_t> time_bytes_;
+  std::vector<uint64_t> plane_;
+  // Text encoding: sample i spans [text_offsets_[i], text_offsets_[i + 1]).
+  std::string text_;
+  std::vector<uint64_t> text_offsets_;
+  std::vector<uint64_t> value_scratch_;
+  // X/Z flags of blocks of samples. Level 0 has an entry per kBlockSize
+  // samples, and each further level an entry per kBlockSize entries of the
+  // level below. Not kept for two state waves, which can't have either.
+  std::vector<std::vector<uint8_t>> summary_;
+};
+
+} // namespace sv
@@ -0,0 +1,264 @@
+#include "sample_store.h"
+#include "gtest/gtest.h"
+#include <random>
+
+namespace sv {
+namespace {
+
+// Straightforward sample list to compare against.
+struct ReferenceSample {
+  uint64_t time;
+  std::string value;
+};
+
+void AddReference(std::vector<ReferenceSample> *samples, uint64_t time,
+                  const std::string &value, bool keep_glitches) {
+  if (!keep_glitches && !samples->empty()) {
+    if (samples->back().value == value) return;
+    if (samples->back().time == time) {
+      if (samples->size() > 1 &&
+          (*samples)[samples->size() - 2].value == value) {
+        samples->pop_back();
+      } else {
+        samples->back().value = value;
+      }
+      return;
+    }
+  }
+  samples->push_back({time, value});
+}
+
+void ExpectSame(const SampleStore &store,
+                const std::vector<ReferenceSample> &ref) {
+  ASSERT_EQ(store.size(), ref.size());
+  for (int i = 0; i < ref.size(); ++i) {
+    EXPECT_EQ(store.Time(i), ref[i].time) << i;
+    EXPECT_EQ(store.Value(i), ref[i].value) << i;
+    EXPECT_EQ(store.HasX(i), ref[i].value.find('x') != std::string::npos);
+    EXPECT_EQ(store.HasZ(i), ref[i].value.find('z') != std::string::npos);
+    for (int pos = 0; pos < ref[i].value.size(); ++pos) {
+      EXPECT_EQ(store.Bit(i, pos), ref[i].value[pos]);
+    }
+  }
+}
+
+std::string RandomValue(std::mt19937 &rng, int width, const char *chars,
+                        int num_chars) {
+  std::string s;
+  for (int i = 0; i < width; ++i) {
+    s += chars[rng() % num_chars];
+  }
+  return s;
+}
+
+TEST(SampleStore, SingleBit) {
+  SampleStore store;
+  store.Add(0, "0", false);
+  store.Add(5, "1", false);
+  store.Add(10, "1", false);
+  store.Add(15, "0", false);
+  ASSERT_EQ(store.size(), 3);
+  EXPECT_EQ(store.Time(2), 15);
+  EXPECT_EQ(store.Value(1), "1");
+  EXPECT_FALSE(store.HasX(0));
+  store.Add(20, "X", false);
+  ASSERT_EQ(store.size(), 4);
+  EXPECT_EQ(store.Value(3), "x");
+  EXPECT_TRUE(store.HasX(3));
+  EXPECT_EQ(store.Value(2), "0");
+}
+
+TEST(SampleStore, BitTransitions) {
+  // Bit 1 (MSB first) goes 0, 1, 0, 1 while the others change too, so that
+  // the ends of the range differ with three transitions in between.
+  SampleStore store(3);
+  store.Add(0, "000", false);
+  store.Add(1, "001", false);
+  store.Add(2, "011", false);
+  store.Add(3, "001", false);
+  store.Add(4, "111", false);
+  store.Add(5, "110", false);
+  EXPECT_EQ(store.BitTransitions(0, 5, 1, 2), 2);
+  EXPECT_EQ(store.BitTransitions(0, 5, 1, 10), 3);
+  EXPECT_EQ(store.BitTransitions(0, 2, 1, 2), 1);
+  EXPECT_EQ(store.BitTransitions(2, 4, 1, 2), 2);
+  EXPECT_EQ(store.BitTransitions(4, 5, 1, 2), 0);
+  EXPECT_EQ(store.BitTransitions(0, 5, 0, 2), 1);
+  EXPECT_EQ(store.BitTransitions(3, 3, 2, 2), 0);
+}
+
+TEST(SampleStore, ExtendsNarrowValues) {
+  SampleStore store(8);
+  store.Add(0, "101", false);
+  store.Add(1, "x1", false);
+  store.Add(2, "Z", false);
+  store.Add(3, "111100001", false);
+  EXPECT_EQ(store.Value(0), "00000101");
+  EXPECT_EQ(store.Value(1), "xxxxxxx1");
+  EXPECT_EQ(store.Value(2), "zzzzzzzz");
+  EXPECT_EQ(store.Value(3), "11100001");
+  // Same value once extended.
+  store.Add(4, "011100001", false);
+  EXPECT_EQ(store.size(), 4);
+}
+
+TEST(SampleStore, TextValues) {
+  SampleStore store(64);
+  store.Add(0, "0", false);
+  store.Add(1, "3.25", false);
+  store.Add(2, "3.25", false);
+  store.Add(3, "1e-05", false);
+  ASSERT_EQ(store.size(), 3);
+  EXPECT_EQ(store.Value(0), std::string(64, '0'));
+  EXPECT_EQ(store.Value(1), "3.25");
+  EXPECT_EQ(store.Value(2), "1e-05");
+}
+
+TEST(SampleStore, LargeTimeGaps) {
+  SampleStore store;
+  std::vector<ReferenceSample> ref;
+  uint64_t time = 0;
+  for (int i = 0; i < 1000; ++i) {
+    time += i % 100 == 99 ? (1ull << (i / 20)) : 1;
+    store.Add(time, i % 2 ? "1" : "0", true);
+    AddReference(&ref, time, i % 2 ? "1" : "0", true);
+  }
+  ExpectSame(store, ref);
+}
+
+TEST(SampleStore, MatchesReference) {
+  std::mt19937 rng(1);
+  for (const bool keep_glitches : {false, true}) {
+    for (const int width : {1, 3, 32, 33, 64, 65, 100}) {
+      SampleStore store(width);
+      std::vector<ReferenceSample> ref;
+      uint64_t time = 0;
+      for (int i = 0; i < 2000; ++i) {
+        time += rng() % 3;
+        // Mostly two state, with x and z showing up later on.
+        const int num_chars = i < 500 ? 2 : 4;
+        std::string value = RandomValue(rng, width, "01xz", num_chars);
+        if (rng() % 2) value = ref.empty() ? value : ref.back().value;
+        store.Add(time, value, keep_glitches);
+        AddReference(&ref, time, value, keep_glitches);
+      }
+      ExpectSame(store, ref);
+    }
+  }
+}
+
+TEST(SampleStore, FindXZMatchesScan) {
+  std::mt19937 rng(3);
+  for (const int width : {1, 40}) {
+    SampleStore store(width);
+    uint64_t time = 0;
+    for (int i = 0; i < 300000; ++i) {
+      time += rng() % 2;
+      // Sparse x and z values, with the occasional glitch removed again.
+      const char *chars = rng() % 5000 == 0 ? "xz" : "01";
+      store.Add(time, RandomValue(rng, width, chars, 2), false);
+    }
+    for (int i = 0; i < 200; ++i) {
+      int first = rng() % store.size();
+      int last = rng() % store.size();
+      if (i % 2) last = std::min(store.size() - 1, first + (int)(rng() % 200));
+      if (first > last) std::swap(first, last);
+      bool has_x, has_z;
+      store.FindXZ(first, last, &has_x, &has_z);
+      bool expect_x = false, expect_z = false;
+      for (int j = first; j <= last; ++j) {
+        expect_x |= store.HasX(j);
+        expect_z |= store.HasZ(j);
+      }
+      EXPECT_EQ(has_x, expect_x) << first << " " << last;
+      EXPECT_EQ(has_z, expect_z) << first << " " << last;
+    }
+  }
+}
+
+TEST(SampleStore, FindIndex) {
+  std::mt19937 rng(4);
+  SampleStore store;
+  EXPECT_EQ(store.FindIndex(10), -1);
+  uint64_t time = 100;
+  for (int i = 0; i < 5000; ++i) {
+    // Repeated times too, with glitches kept.
+    time += rng() % 3 == 0 ? 0 : rng() % 1000;
+    store.Add(time, i % 2 ? "1" : "0", true);
+  }
+  auto expected = [&](uint64_t t) {
+    int idx = 0;
+    while (idx + 1 < store.size() && store.Time(idx + 1) <= t) idx++;
+    return idx;
+  };
+  EXPECT_EQ(store.FindIndex(0), 0);
+  EXPECT_EQ(store.FindIndex(time + 1), store.size() - 1);
+  int hint = 0;
+  for (uint64_t t = 0; t < time + 1000; t += rng() % 2000) {
+    const int idx = expected(t);
+    EXPECT_EQ(store.FindIndex(t), idx) << t;
+    EXPECT_EQ(store.FindIndex(t, hint), idx) << t;
+    hint = idx;
+  }
+}
+
+TEST(SampleStore, AppendMatchesAdd) {
+  std::mt19937 rng(2);
+  for (const bool keep_glitches : {false, true}) {
+    for (const int width : {1, 7, 70}) {
+      // Split the same sequence over a few stores and stitch them together.
+      SampleStore whole(width);
+      std::vector<SampleStore> parts(4, SampleStore(width));
+      uint64_t time = 0;
+      for (int i = 0; i < 800; ++i) {
+        time += rng() % 2;
+        const int part = i / 200;
+        const int num_chars = part == 2 ? 4 : 2;
+        const std::string value = RandomValue(rng, width, "01xz", num_chars);
+        whole.Add(time, value, keep_glitches);
+        parts[part].Add(time, value, keep_glitches);
+      }
+      SampleStore stitched(width);
+      for (const auto &part : parts) {
+        stitched.Append(part, keep_glitches);
+      }
+      ASSERT_EQ(stitched.size(), whole.size());
+      for (int i = 0; i < whole.size(); ++i) {
+        EXPECT_EQ(stitched.Time(i), whole.Time(i));
+        EXPECT_EQ(stitched.Value(i), whole.Value(i));
+      }
+      bool has_x, has_z;
+      stitched.FindXZ(0, stitched.size() - 1, &has_x, &has_z);
+      EXPECT_TRUE(has_x);
+      EXPECT_TRUE(has_z);
+    }
+  }
+}
+
+TEST(SampleStore, ExtendSkipsOverlap) {
+  for (const bool keep_glitches : {false, true}) {
+    SampleStore store(4);
+    store.Add(0, "0000", keep_glitches);
+    store.Add(10, "0001", keep_glitches);
+    // A later read that starts with the value at time 8.
+    SampleStore other(4);
+    other.Add(8, "0000", keep_glitches);
+    other.Add(10, "0001", keep_glitches);
+    other.Add(20, "0010", keep_glitches);
+    other.Add(30, "0010", keep_glitches);
+    store.Extend(std::move(other), 15, keep_glitches);
+    ASSERT_EQ(store.size(), keep_glitches ? 4 : 3);
+    EXPECT_EQ(store.Time(2), 20);
+    EXPECT_EQ(store.Value(2), "0010");
+    // One that starts with the value at time 40, which isn't a change.
+    SampleStore last(4);
+    last.Add(40, "0010", keep_glitches);
+    last.Add(50, "0011", keep_glitches);
+    store.Extend(std::move(last), 39, keep_glitches);
+    ASSERT_EQ(store.size(), keep_glitches ? 5 : 4);
+    EXPECT_EQ(store.Time(store.size() - 1), 50);
+  }
+}
+
+} // namespace
+} // namespace sv
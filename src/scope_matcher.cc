@@ -0,0 +1,120 @@
+#include "scope_matcher.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "utils.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace sv {
+namespace {
+
+// Names in more wave scopes than this aren't used to find candidates.
+constexpr int kMaxScopesPerName = 64;
+// Number of candidates per design scope that get an exact score.
+constexpr int kMaxCandidates = 8;
+
+struct Match {
+  int wave_scope = -1;
+  double score = 0;
+  bool same_name = false;
+
+  bool operator<(const Match &other) const {
+    if (score != other.score) return score < other.score;
+    return !same_name && other.same_name;
+  }
+};
+
+// Sorted, unique hashes of the signal names of each scope.
+std::vector<std::vector<uint64_t>>
+HashNames(const std::vector<MatchScope> &scopes) {
+  std::vector<std::vector<uint64_t>> hashes(scopes.size());
+  ParallelFor(scopes.size(), [&](int i) {
+    auto &h = hashes[i];
+    h.reserve(scopes[i].signal_names.size());
+    for (const auto name : scopes[i].signal_names) {
+      h.push_back(absl::HashOf(name));
+    }
+    std::sort(h.begin(), h.end());
+    h.erase(std::unique(h.begin(), h.end()), h.end());
+  });
+  return hashes;
+}
+
+int NumCommon(const std::vector<uint64_t> &a, const std::vector<uint64_t> &b) {
+  int n = 0;
+  auto it_a = a.begin();
+  auto it_b = b.begin();
+  while (it_a != a.end() && it_b != b.end()) {
+    if (*it_a < *it_b) {
+      ++it_a;
+    } else if (*it_b < *it_a) {
+      ++it_b;
+    } else {
+      n++;
+      ++it_a;
+      ++it_b;
+    }
+  }
+  return n;
+}
+
+} // namespace
+
+std::optional<std::pair<int, int>>
+MatchScopes(const std::vector<MatchScope> &design,
+            const std::vector<MatchScope> &waves) {
+  const auto design_hashes = HashNames(design);
+  const auto wave_hashes = HashNames(waves);
+  // Which wave scopes each name is in.
+  absl::flat_hash_map<uint64_t, std::vector<int>> scopes_by_name;
+  for (int i = 0; i < waves.size(); ++i) {
+    for (const uint64_t h : wave_hashes[i]) {
+      auto &scopes = scopes_by_name[h];
+      if (scopes.size() <= kMaxScopesPerName) scopes.push_back(i);
+    }
+  }
+
+  // Best match of each design scope.
+  std::vector<Match> matches(design.size());
+  ParallelFor(design.size(), [&](int i) {
+    const auto &hashes = design_hashes[i];
+    // Count the shared names, as far as they are indexed.
+    absl::flat_hash_map<int, int> hits;
+    for (const uint64_t h : hashes) {
+      const auto it = scopes_by_name.find(h);
+      if (it == scopes_by_name.end()) continue;
+      if (it->second.size() > kMaxScopesPerName) continue;
+      for (const int wave_scope : it->second) hits[wave_scope]++;
+    }
+    std::vector<std::pair<int, int>> candidates(hits.begin(), hits.end());
+    const int num_candidates = std::min<int>(kMaxCandidates, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + num_candidates,
+                      candidates.end(), [](const auto &a, const auto &b) {
+                        if (a.second != b.second) return a.second > b.second;
+                        return a.first < b.first;
+                      });
+    for (int c = 0; c < num_candidates; ++c) {
+      const int wave_scope = candidates[c].first;
+      const int common = NumCommon(hashes, wave_hashes[wave_scope]);
+      const int total = hashes.size() + wave_hashes[wave_scope].size() - common;
+      Match match = {.wave_scope = wave_scope,
+                     .score = static_cast<double>(common) * common / total,
+                     .same_name = design[i].name == waves[wave_scope].name};
+      if (matches[i] < match) matches[i] = match;
+    }
+  });
+  const auto best = std::max_element(matches.begin(), matches.end());
+  if (best == matches.end() || best->wave_scope < 0) return std::nullopt;
+
+  // Move up to where the two hierarchies start to correspond.
+  int d = best - matches.begin();
+  int w = best->wave_scope;
+  while (design[d].parent >= 0 && waves[w].parent >= 0 &&
+         design[d].name == waves[w].name) {
+    d = design[d].parent;
+    w = waves[w].parent;
+  }
+  return std::make_pair(d, w);
+}
+
+} // namespace sv
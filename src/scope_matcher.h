@@ -0,0 +1,36 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sv {
+
+// A scope of the design or the waves, as far as matching the two goes.
+struct MatchScope {
+  // Name of the scope itself, without any library prefix.
+  std::string_view name;
+  // Names of the nets or signals directly in the scope.
+  std::vector<std::string_view> signal_names;
+  // Index of the enclosing scope, or -1 for the roots. Parents come first.
+  int parent;
+};
+
+// Finds the design scope and wave scope that correspond to each other, as the
+// indices of each. The pair whose sets of signal names are most alike is
+// found first, taking both the number of names they have in common and the
+// Jaccard similarity into account. Since the rest of the design is found from
+// there by scope names, that pair is then moved up through the parents, as
+// long as their names agree.
+//
+// All scopes at any depth are considered. Candidate pairs come from an index
+// of which wave scopes each name is in, and are scored in parallel, so this
+// scales to designs with millions of nets. Names that are in very many scopes,
+// like clocks and resets, say little about a match and are skipped for finding
+// candidates. Returns nothing if no pair has any names in common.
+std::optional<std::pair<int, int>>
+MatchScopes(const std::vector<MatchScope> &design,
+            const std::vector<MatchScope> &waves);
+
+} // namespace sv
@@ -0,0 +1,99 @@
+#include "scope_matcher.h"
+#include "gtest/gtest.h"
+#include <deque>
+#include <random>
+#include <string>
+
+namespace sv {
+namespace {
+
+// Keeps the names alive for the string views in the scopes.
+class Hierarchy {
+ public:
+  int Add(const std::string &name, int parent,
+          const std::vector<std::string> &signals) {
+    MatchScope scope = {.name = Save(name), .signal_names = {},
+                        .parent = parent};
+    for (const auto &s : signals) scope.signal_names.push_back(Save(s));
+    scopes_.push_back(std::move(scope));
+    return scopes_.size() - 1;
+  }
+  const std::vector<MatchScope> &Scopes() const { return scopes_; }
+
+ private:
+  std::string_view Save(const std::string &s) { return names_.emplace_back(s); }
+
+  std::deque<std::string> names_;
+  std::vector<MatchScope> scopes_;
+};
+
+TEST(ScopeMatcher, MatchesWhereHierarchiesMeet) {
+  // The design is instantiated as dut_i in a testbench.
+  Hierarchy design;
+  const int dut = design.Add("dut", -1, {"clk", "rst", "req", "gnt"});
+  design.Add("u_fifo", dut, {"clk", "rst", "wr_ptr", "rd_ptr", "mem"});
+  design.Add("u_arb", dut, {"clk", "rst", "req", "gnt", "last"});
+  Hierarchy waves;
+  const int tb = waves.Add("tb", -1, {"clk", "rst", "done"});
+  const int dut_i = waves.Add("dut_i", tb, {"clk", "rst", "req", "gnt"});
+  waves.Add("u_fifo", dut_i, {"clk", "rst", "wr_ptr", "rd_ptr", "mem"});
+  waves.Add("u_arb", dut_i, {"clk", "rst", "req", "gnt", "last"});
+  const auto match = MatchScopes(design.Scopes(), waves.Scopes());
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->first, dut);
+  EXPECT_EQ(match->second, dut_i);
+}
+
+TEST(ScopeMatcher, NoCommonNames) {
+  Hierarchy design;
+  design.Add("top", -1, {"a", "b"});
+  Hierarchy waves;
+  waves.Add("top", -1, {"c", "d"});
+  EXPECT_FALSE(MatchScopes(design.Scopes(), waves.Scopes()));
+  EXPECT_FALSE(MatchScopes({}, waves.Scopes()));
+}
+
+TEST(ScopeMatcher, PrefersSimilarScopes) {
+  // Both wave scopes share three names with the design scope, but one of them
+  // has a lot more besides.
+  Hierarchy design;
+  design.Add("core", -1, {"a", "b", "c"});
+  Hierarchy waves;
+  const int root = waves.Add("root", -1, {});
+  waves.Add("big", root, {"a", "b", "c", "d", "e", "f", "g", "h"});
+  const int core = waves.Add("other", root, {"a", "b", "c", "x"});
+  const auto match = MatchScopes(design.Scopes(), waves.Scopes());
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->second, core);
+}
+
+TEST(ScopeMatcher, LargeHierarchy) {
+  // A deep random tree with some names in every scope. The wave hierarchy has
+  // the same design under a testbench.
+  std::mt19937 rng(1);
+  Hierarchy design;
+  Hierarchy waves;
+  const int tb = waves.Add("tb", -1, {"clk", "rst_n"});
+  std::vector<std::pair<int, int>> parents = {{-1, tb}};
+  for (int i = 0; i < 20000; ++i) {
+    const auto [design_parent, wave_parent] = parents[rng() % parents.size()];
+    const std::string name = "u" + std::to_string(i);
+    std::vector<std::string> signals = {"clk", "rst_n", "valid", "ready"};
+    for (int j = 0; j < 5; ++j) {
+      signals.push_back(name + "_s" + std::to_string(j));
+    }
+    const int d = design.Add(design_parent < 0 ? "top" : name, design_parent,
+                             signals);
+    const int w = waves.Add(design_parent < 0 ? "top_i" : name, wave_parent,
+                            signals);
+    parents.push_back({d, w});
+    if (design_parent < 0) parents.erase(parents.begin());
+  }
+  const auto match = MatchScopes(design.Scopes(), waves.Scopes());
+  ASSERT_TRUE(match);
+  EXPECT_EQ(match->first, 0);
+  EXPECT_EQ(match->second, 1);
+}
+
+} // namespace
+} // namespace sv
@@ -0,0 +1,291 @@
+#include "signal_index.h"
+#include "utils.h"
+#include <algorithm>
+#include <queue>
+
+namespace sv {
+namespace {
+
+// Names are matched in blocks of this many on each thread.
+constexpr int kMatchBlockSize = 4096;
+// Scores of the ways a part can match a name, best first. Fuzzy matches lose
+// a point for each character they skip.
+constexpr int kExactScore = 4000;
+constexpr int kPrefixScore = 3000;
+constexpr int kGlobScore = 2500;
+constexpr int kSubstringScore = 2000;
+constexpr int kFuzzyScore = 1000;
+constexpr int kMaxFuzzyPenalty = 999;
+
+std::string ToLower(std::string_view s) {
+  std::string lower(s);
+  for (char &c : lower) {
+    if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+  }
+  return lower;
+}
+
+bool IsGlob(std::string_view part) {
+  return part.find_first_of("*?") != std::string_view::npos;
+}
+
+bool GlobMatch(std::string_view pattern, std::string_view name) {
+  int p = 0;
+  int n = 0;
+  // Where to pick up again after the last *, if what follows it fails.
+  int star = -1;
+  int star_n = 0;
+  while (n < name.size()) {
+    if (p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n])) {
+      p++;
+      n++;
+    } else if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      star_n = n;
+    } else if (star >= 0) {
+      p = star + 1;
+      n = ++star_n;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '*') p++;
+  return p == pattern.size();
+}
+
+int MatchPart(std::string_view part, std::string_view name) {
+  if (part.empty()) return 0;
+  if (IsGlob(part)) return GlobMatch(part, name) ? kGlobScore : -1;
+  const auto pos = name.find(part);
+  if (pos == 0) return part.size() == name.size() ? kExactScore : kPrefixScore;
+  if (pos != std::string_view::npos) return kSubstringScore;
+  // All characters in order, as close together as they come first.
+  int first = -1;
+  int n = 0;
+  for (const char c : part) {
+    while (n < name.size() && name[n] != c) n++;
+    if (n == name.size()) return -1;
+    if (first < 0) first = n;
+    n++;
+  }
+  const int skipped = n - first - part.size();
+  return kFuzzyScore - std::min(skipped, kMaxFuzzyPenalty);
+}
+
+uint32_t Trigram(std::string_view s, int pos) {
+  return static_cast<uint8_t>(s[pos]) << 16 |
+         static_cast<uint8_t>(s[pos + 1]) << 8 |
+         static_cast<uint8_t>(s[pos + 2]);
+}
+
+struct Match {
+  int score;
+  int depth;
+  int length;
+  int signal;
+
+  // Better matches come first.
+  bool operator<(const Match &other) const {
+    if (score != other.score) return score > other.score;
+    if (depth != other.depth) return depth < other.depth;
+    if (length != other.length) return length < other.length;
+    return signal < other.signal;
+  }
+};
+
+} // namespace
+
+int SignalIndex::Names::Add(std::string_view name) {
+  const auto [it, inserted] = ids.emplace(ToLower(name), names.size());
+  if (inserted) names.push_back(it->first);
+  return it->second;
+}
+
+SignalIndex::SignalIndex(const std::vector<Scope> &scopes,
+                         const std::vector<Signal> &signals) {
+  scope_parents_.reserve(scopes.size());
+  scope_name_ids_.reserve(scopes.size());
+  scope_depths_.reserve(scopes.size());
+  for (const auto &scope : scopes) {
+    scope_parents_.push_back(scope.parent);
+    scope_name_ids_.push_back(scope_names_.Add(scope.name));
+    scope_depths_.push_back(
+        scope.parent < 0 ? 0 : scope_depths_[scope.parent] + 1);
+  }
+  // Group the signals by name.
+  std::vector<int> name_ids;
+  name_ids.reserve(signals.size());
+  for (const auto &signal : signals) {
+    name_ids.push_back(signal_names_.Add(signal.name));
+  }
+  const int num_names = signal_names_.names.size();
+  signals_by_name_offsets_.assign(num_names + 1, 0);
+  for (const int id : name_ids) signals_by_name_offsets_[id + 1]++;
+  for (int i = 1; i <= num_names; ++i) {
+    signals_by_name_offsets_[i] += signals_by_name_offsets_[i - 1];
+  }
+  std::vector<int> next(signals_by_name_offsets_.begin(),
+                        signals_by_name_offsets_.end() - 1);
+  signals_by_name_.resize(signals.size());
+  for (int i = 0; i < signals.size(); ++i) {
+    const int scope = signals[i].scope;
+    signals_by_name_[next[name_ids[i]]++] = {
+        .signal = i,
+        .scope = scope,
+        .depth = scope < 0 ? 0 : scope_depths_[scope] + 1};
+  }
+  // Only the names themselves are needed from here on.
+  signal_names_.ids = {};
+  scope_names_.ids = {};
+  for (int id = 0; id < num_names; ++id) {
+    const std::string &name = signal_names_.names[id];
+    for (int pos = 0; pos + 3 <= name.size(); ++pos) {
+      auto &ids = trigrams_[Trigram(name, pos)];
+      // Names are added in order, so a repeated trigram is at the back.
+      if (ids.empty() || ids.back() != id) ids.push_back(id);
+    }
+  }
+}
+
+std::vector<int> SignalIndex::Candidates(std::string_view part) const {
+  // Every trigram of the part must be in the name, so the least common one
+  // narrows it down the most.
+  const std::vector<int> *fewest = nullptr;
+  for (int pos = 0; pos + 3 <= part.size(); ++pos) {
+    const auto it = trigrams_.find(Trigram(part, pos));
+    if (it == trigrams_.end()) return {};
+    if (fewest == nullptr || it->second.size() < fewest->size()) {
+      fewest = &it->second;
+    }
+  }
+  return *fewest;
+}
+
+std::vector<int>
+SignalIndex::MatchNames(std::string_view part, const Names &names,
+                        const std::vector<int> *candidates) const {
+  std::vector<int> scores(names.names.size(), -1);
+  const int n = candidates != nullptr ? candidates->size() : scores.size();
+  ParallelFor((n + kMatchBlockSize - 1) / kMatchBlockSize, [&](int block) {
+    const int end = std::min(n, (block + 1) * kMatchBlockSize);
+    for (int i = block * kMatchBlockSize; i < end; ++i) {
+      const int id = candidates != nullptr ? (*candidates)[i] : i;
+      scores[id] = MatchPart(part, names.names[id]);
+    }
+  });
+  return scores;
+}
+
+std::vector<int> SignalIndex::Find(std::string_view query, int max_results,
+                                   int *num_matches) const {
+  if (num_matches != nullptr) *num_matches = 0;
+  const std::string lower = ToLower(query);
+  std::vector<std::string_view> parts;
+  for (size_t start = 0; start <= lower.size();) {
+    size_t end = lower.find('.', start);
+    if (end == std::string::npos) end = lower.size();
+    parts.push_back(std::string_view(lower).substr(start, end - start));
+    start = end + 1;
+  }
+  const std::string_view leaf = parts.back();
+  parts.pop_back();
+  parts.erase(std::remove(parts.begin(), parts.end(), std::string_view()),
+              parts.end());
+  if (leaf.empty() && parts.empty()) return {};
+
+  // How many of the scope parts the path down to each scope matches, and the
+  // scores of those.
+  std::vector<int> progress;
+  std::vector<int> path_scores;
+  if (!parts.empty()) {
+    std::vector<std::vector<int>> part_scores;
+    for (const auto part : parts) {
+      part_scores.push_back(MatchNames(part, scope_names_, nullptr));
+    }
+    progress.resize(scope_parents_.size());
+    path_scores.resize(scope_parents_.size());
+    for (int s = 0; s < scope_parents_.size(); ++s) {
+      const int parent = scope_parents_[s];
+      progress[s] = parent < 0 ? 0 : progress[parent];
+      path_scores[s] = parent < 0 ? 0 : path_scores[parent];
+      if (progress[s] == parts.size()) continue;
+      const int score = part_scores[progress[s]][scope_name_ids_[s]];
+      if (score >= 0) {
+        progress[s]++;
+        path_scores[s] += score;
+      }
+    }
+  }
+
+  // The best matches of each block of names, and how many there are in all.
+  std::vector<Match> best;
+  int count = 0;
+  auto collect = [&](const std::vector<int> &leaf_scores) {
+    const int num_blocks =
+        (leaf_scores.size() + kMatchBlockSize - 1) / kMatchBlockSize;
+    std::vector<std::vector<Match>> block_best(num_blocks);
+    std::vector<int> block_counts(num_blocks);
+    ParallelFor(num_blocks, [&](int block) {
+      // The worst of the best ones so far is on top.
+      std::priority_queue<Match> queue;
+      const int end = std::min<int>(leaf_scores.size(),
+                                    (block + 1) * kMatchBlockSize);
+      for (int id = block * kMatchBlockSize; id < end; ++id) {
+        if (leaf_scores[id] < 0) continue;
+        for (int i = signals_by_name_offsets_[id];
+             i < signals_by_name_offsets_[id + 1]; ++i) {
+          const auto &[signal, scope, depth] = signals_by_name_[i];
+          Match match = {.score = leaf_scores[id],
+                         .depth = depth,
+                         .length = static_cast<int>(
+                             signal_names_.names[id].size()),
+                         .signal = signal};
+          if (!parts.empty()) {
+            if (scope < 0 || progress[scope] < parts.size()) continue;
+            match.score += path_scores[scope];
+          }
+          block_counts[block]++;
+          if (queue.size() < max_results) {
+            queue.push(match);
+          } else if (max_results > 0 && match < queue.top()) {
+            queue.pop();
+            queue.push(match);
+          }
+        }
+      }
+      for (; !queue.empty(); queue.pop()) {
+        block_best[block].push_back(queue.top());
+      }
+    });
+    best.clear();
+    count = 0;
+    for (int block = 0; block < num_blocks; ++block) {
+      best.insert(best.end(), block_best[block].begin(),
+                  block_best[block].end());
+      count += block_counts[block];
+    }
+  };
+  if (leaf.size() >= 3 && !IsGlob(leaf)) {
+    // Names that contain the part are found through the index. Only if those
+    // are not enough are the rest of the names tried for fuzzy matches.
+    const std::vector<int> candidates = Candidates(leaf);
+    std::vector<int> scores = MatchNames(leaf, signal_names_, &candidates);
+    for (const int id : candidates) {
+      if (scores[id] < kSubstringScore) scores[id] = -1;
+    }
+    collect(scores);
+  }
+  if (count < max_results || leaf.size() < 3 || IsGlob(leaf)) {
+    collect(MatchNames(leaf, signal_names_, nullptr));
+  }
+
+  if (num_matches != nullptr) *num_matches = count;
+  const int num_results = std::min<int>(max_results, best.size());
+  std::partial_sort(best.begin(), best.begin() + num_results, best.end());
+  std::vector<int> results;
+  results.reserve(num_results);
+  for (int i = 0; i < num_results; ++i) results.push_back(best[i].signal);
+  return results;
+}
+
+} // namespace sv
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "absl/container/flat_hash_map.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sv {
+
+// Finds signals anywhere in a wave hierarchy by what is typed of their path,
+// quickly enough to search millions of signals on every keystroke.
+//
+// The query is split into parts at the dots. The last part matches signal
+// names, the others the names of enclosing scopes, in order but not
+// necessarily every scope on the way. A part that has * or ? in it is a glob
+// pattern for the whole name. Otherwise it matches names that it is in, or
+// failing that, names that have its characters in the same order (fuzzy).
+// Case is ignored. The best matches come first: exact names, then prefixes,
+// then names containing the part, then fuzzy matches, then shorter paths.
+//
+// Each distinct name is only matched once per query. The signal names are
+// indexed by trigram, so that the ones containing the part don't have to be
+// looked for among all of them.
+class SignalIndex {
+ public:
+  struct Scope {
+    std::string_view name;
+    // Index of the enclosing scope, or -1 for the roots. Parents come first.
+    int parent;
+  };
+  struct Signal {
+    std::string_view name;
+    int scope;
+  };
+  SignalIndex(const std::vector<Scope> &scopes,
+              const std::vector<Signal> &signals);
+  // Indices of the best matching signals, best first, up to max_results. The
+  // number of matches in total goes to num_matches if given. Fuzzy matches are
+  // only looked for, and counted, if there are fewer than max_results others.
+  std::vector<int> Find(std::string_view query, int max_results,
+                        int *num_matches = nullptr) const;
+
+ private:
+  // Distinct names, in lower case.
+  struct Names {
+    int Add(std::string_view name);
+    std::vector<std::string> names;
+    absl::flat_hash_map<std::string, int> ids;
+  };
+  // Scores of matching the part against each name, -1 where it doesn't. With
+  // candidates given, only those are matched.
+  std::vector<int> MatchNames(std::string_view part, const Names &names,
+                              const std::vector<int> *candidates) const;
+  // Signal names that contain the part, which must be at least 3 characters.
+  std::vector<int> Candidates(std::string_view part) const;
+
+  Names signal_names_;
+  Names scope_names_;
+  std::vector<int> scope_parents_;
+  std::vector<int> scope_name_ids_;
+  std::vector<int> scope_depths_;
+  // Signals by name ID, with what is needed to rank them next to each other.
+  struct NamedSignal {
+    int signal;
+    int scope;
+    int depth;
+  };
+  std::vector<int> signals_by_name_offsets_;
+  std::vector<NamedSignal> signals_by_name_;
+  // Signal name IDs by trigram.
+  absl::flat_hash_map<uint32_t, std::vector<int>> trigrams_;
+};
+
+} // namespace sv
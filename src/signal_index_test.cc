@@ -0,0 +1,106 @@
+#include "signal_index.h"
+#include "gtest/gtest.h"
+#include <deque>
+#include <string>
+
+namespace sv {
+namespace {
+
+// Keeps the names alive for the string views in the hierarchy.
+class Hierarchy {
+ public:
+  int AddScope(const std::string &name, int parent) {
+    scopes_.push_back({.name = Save(name), .parent = parent});
+    return scopes_.size() - 1;
+  }
+  int AddSignal(const std::string &name, int scope) {
+    signals_.push_back({.name = Save(name), .scope = scope});
+    return signals_.size() - 1;
+  }
+  SignalIndex Index() const { return SignalIndex(scopes_, signals_); }
+
+ private:
+  std::string_view Save(const std::string &s) { return names_.emplace_back(s); }
+
+  std::deque<std::string> names_;
+  std::vector<SignalIndex::Scope> scopes_;
+  std::vector<SignalIndex::Signal> signals_;
+};
+
+TEST(SignalIndex, RanksMatches) {
+  Hierarchy h;
+  const int top = h.AddScope("top", -1);
+  const int core = h.AddScope("core", top);
+  const int fuzzy = h.AddSignal("d_a_t_a", core);
+  const int substring = h.AddSignal("rd_data", core);
+  const int prefix = h.AddSignal("data_valid", core);
+  const int exact = h.AddSignal("data", core);
+  const int shallow = h.AddSignal("data", top);
+  h.AddSignal("address", core);
+  const auto index = h.Index();
+  int num_matches = 0;
+  EXPECT_EQ(index.Find("data", 4, &num_matches),
+            std::vector<int>({shallow, exact, prefix, substring}));
+  EXPECT_EQ(num_matches, 4);
+  // Fuzzy matches show up when there aren't enough others.
+  EXPECT_EQ(index.Find("data", 10, &num_matches),
+            std::vector<int>({shallow, exact, prefix, substring, fuzzy}));
+  EXPECT_EQ(num_matches, 5);
+  EXPECT_EQ(index.Find("DATA", 1), std::vector<int>({shallow}));
+  // Those with fewer characters skipped come first.
+  EXPECT_EQ(index.Find("dta", 10),
+            std::vector<int>({shallow, exact, prefix, substring, fuzzy}));
+  EXPECT_TRUE(index.Find("xyz", 10).empty());
+  EXPECT_TRUE(index.Find("", 10).empty());
+}
+
+TEST(SignalIndex, MatchesScopes) {
+  Hierarchy h;
+  const int top = h.AddScope("top", -1);
+  const int cpu0 = h.AddScope("cpu0", top);
+  const int cpu1 = h.AddScope("cpu1", top);
+  const int alu0 = h.AddScope("alu", cpu0);
+  const int alu1 = h.AddScope("alu", cpu1);
+  const int res0 = h.AddSignal("result", alu0);
+  const int res1 = h.AddSignal("result", alu1);
+  const int clk0 = h.AddSignal("clk", cpu0);
+  const auto index = h.Index();
+  EXPECT_EQ(index.Find("cpu1.alu.res", 10), std::vector<int>({res1}));
+  // Levels in between can be left out.
+  EXPECT_EQ(index.Find("top.res", 10), std::vector<int>({res0, res1}));
+  EXPECT_EQ(index.Find("cpu0.", 10), std::vector<int>({clk0, res0}));
+  EXPECT_EQ(index.Find("cpu?.*.r*t", 10), std::vector<int>({res0, res1}));
+  EXPECT_TRUE(index.Find("alu.clk", 10).empty());
+}
+
+TEST(SignalIndex, ManySignals) {
+  // Distinct names in many scopes, checked against going through all of them.
+  Hierarchy h;
+  const int top = h.AddScope("top", -1);
+  std::vector<std::string> names;
+  for (int i = 0; i < 200; ++i) {
+    const int scope = h.AddScope("u" + std::to_string(i), top);
+    for (int j = 0; j < 500; ++j) {
+      const std::string name = "sig_" + std::to_string(i * 7 + j);
+      h.AddSignal(name, scope);
+      names.push_back(name);
+    }
+  }
+  const auto index = h.Index();
+  for (const std::string query : {"sig_12", "g_99", "_100"}) {
+    int expected = 0;
+    for (const auto &name : names) {
+      if (name.find(query) != std::string::npos) expected++;
+    }
+    int num_matches = 0;
+    const auto results = index.Find(query, 100, &num_matches);
+    EXPECT_EQ(num_matches, expected) << query;
+    ASSERT_EQ(results.size(), 100) << query;
+    for (const int signal : results) {
+      EXPECT_NE(names[signal].find(query), std::string::npos) << query;
+    }
+  }
+}
+
+} // namespace
+} // namespace sv
@@ -10,11 +10,11 @@ std::string kNetString;
 std::string kParameterString = "[P]";
 } // namespace
 
-SignalTreeItem::SignalTreeItem(const WaveData::Signal *s) : signal_(s) {
+SignalTreeItem::SignalTreeItem(const WaveData::Signal *s, bool full_path)
+    : signal_(s) {
+  name_ = full_path ? WaveData::SignalToPath(s) : std::string(s->name);
   if (s->width > 1 && !s->has_suffix) {
-    name_ = s->name + absl::StrFormat("[%d:%d]", s->width - 1 + s->lsb, s->lsb);
-  } else {
-    name_ = s->name;
+    name_ += absl::StrFormat("[%d:%d]", s->width - 1 + s->lsb, s->lsb);
   }
 }
 
@@ -5,13 +5,14 @@
 
 namespace sv {
 
-// Holds a signal for the signal list that comes from a single scope. The
-// TreeItem API is used to have a consistent list navigating UI eventhough this
-// data isn't actually hierarchical (just a flat list of signals for the given
-// scope).
+// Holds a signal for the signal list that comes from a single scope, or from a
+// search of all of them. The TreeItem API is used to have a consistent list
+// navigating UI eventhough this data isn't actually hierarchical (just a flat
+// list of signals).
 class SignalTreeItem : public TreeItem {
  public:
-  explicit SignalTreeItem(const WaveData::Signal *s);
+  // The full path is shown when the signals are from different scopes.
+  explicit SignalTreeItem(const WaveData::Signal *s, bool full_path = false);
   const std::string &Name() const final { return name_; }
   const std::string &Type() const final;
   bool AltType() const final;
@@ -270,7 +270,7 @@ bool IsLeadingIdentifierCharacater(char c) {
 
 } // namespace
 
-void SimpleTokenizer::ProcessLine(const std::string &s) {
+void SimpleTokenizer::ProcessLine(std::string_view s) {
   int start_pos = 0;
   bool in_identifier = false;
   bool in_escaped_identifier = false;
@@ -294,7 +294,7 @@ void SimpleTokenizer::ProcessLine(const std::string &s) {
           continue;
         }
         identifiers_[line_num_].push_back(
-            {start_pos, s.substr(start_pos, i - start_pos)});
+            {start_pos, std::string(s.substr(start_pos, i - start_pos))});
       }
     } else if (in_identifier) {
       if (!IsInternalIdentifierCharacater(c) || i == s.size() - 1) {
@@ -313,7 +313,7 @@ void SimpleTokenizer::ProcessLine(const std::string &s) {
           last_token_was_dot_ = false;
           continue;
         }
-        auto text = s.substr(start_pos, last_pos - start_pos + 1);
+        auto text = std::string(s.substr(start_pos, last_pos - start_pos + 1));
         if (IsKeyword(text)) {
           keywords_[line_num_].push_back({start_pos, last_pos});
         } else {
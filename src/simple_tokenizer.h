@@ -2,6 +2,7 @@
 
 #include "absl/container/flat_hash_map.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace sv {
@@ -12,7 +13,24 @@ namespace sv {
 // literals and compiler directives / macros.
 class SimpleTokenizer {
  public:
-  void ProcessLine(const std::string &s);
+  // What carries over from one line to the next.
+  struct State {
+    bool in_block_comment = false;
+    bool in_string_literal = false;
+    bool last_token_was_dot = false;
+  };
+  SimpleTokenizer() = default;
+  // Starts in the middle of a file, at the given line and with the state that
+  // the lines before it left.
+  SimpleTokenizer(int line_num, const State &state)
+      : line_num_(line_num), in_block_comment_(state.in_block_comment),
+        in_string_literal_(state.in_string_literal),
+        last_token_was_dot_(state.last_token_was_dot) {}
+  void ProcessLine(std::string_view s);
+  // The state for the line after the last one processed.
+  State CurrentState() const {
+    return {in_block_comment_, in_string_literal_, last_token_was_dot_};
+  }
   // Returns a list of ranges in the line that are part of comments.
   std::vector<std::pair<int, int>> &Comments(int line) {
     return comments_[line];
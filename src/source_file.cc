@@ -0,0 +1,87 @@
+#include "source_file.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace sv {
+
+SourceFile::SourceFile(const std::string &file_name) : file_(file_name) {
+  const std::string_view data = file_.Data();
+  // Like std::getline, there is no empty line after a final newline.
+  uint64_t pos = 0;
+  while (pos < data.size()) {
+    line_starts_.push_back(pos);
+    const void *nl = memchr(data.data() + pos, '\n', data.size() - pos);
+    if (nl == nullptr) break;
+    pos = static_cast<const char *>(nl) - data.data() + 1;
+  }
+}
+
+std::string_view SourceFile::Line(int line) const {
+  const std::string_view data = file_.Data();
+  const uint64_t start = line_starts_[line];
+  uint64_t end =
+      line + 1 < line_starts_.size() ? line_starts_[line + 1] : data.size();
+  if (end > start && data[end - 1] == '\n') end--;
+  if (end > start && data[end - 1] == '\r') end--;
+  return data.substr(start, end - start);
+}
+
+SimpleTokenizer &SourceFile::Tokens(int line) {
+  const int block = line / kBlockSize;
+  for (auto it = blocks_.begin(); it != blocks_.end(); ++it) {
+    if (it->first == block) {
+      blocks_.splice(blocks_.begin(), blocks_, it);
+      return blocks_.front().second;
+    }
+  }
+  // The state at the start of the block depends on everything before it, so
+  // the blocks up to it have to be tokenized first if that hasn't been done.
+  SimpleTokenizer tokenizer;
+  for (int b = std::min<int>(block, block_states_.size() - 1); b <= block;
+       ++b) {
+    tokenizer = SimpleTokenizer(b * kBlockSize, block_states_[b]);
+    const int end = std::min((b + 1) * kBlockSize, NumLines());
+    for (int l = b * kBlockSize; l < end; ++l) {
+      tokenizer.ProcessLine(Line(l));
+    }
+    if (b + 1 == block_states_.size()) {
+      block_states_.push_back(tokenizer.CurrentState());
+    }
+  }
+  if (blocks_.size() >= kMaxBlocks) blocks_.pop_back();
+  blocks_.emplace_front(block, std::move(tokenizer));
+  return blocks_.front().second;
+}
+
+std::shared_ptr<SourceFile>
+SourceFileCache::Get(const std::string &file_name) {
+  struct stat st;
+  if (stat(file_name.c_str(), &st) != 0) return nullptr;
+  const uint64_t size = st.st_size;
+  const int64_t mtime = st.st_mtim.tv_sec * 1'000'000'000 + st.st_mtim.tv_nsec;
+  for (auto it = files_.begin(); it != files_.end(); ++it) {
+    if (it->file_name != file_name) continue;
+    if (it->size == size && it->mtime == mtime) {
+      files_.splice(files_.begin(), files_, it);
+      return files_.front().file;
+    }
+    files_.erase(it);
+    break;
+  }
+  std::shared_ptr<SourceFile> file;
+  try {
+    file = std::make_shared<SourceFile>(file_name);
+  } catch (const std::runtime_error &) {
+    return nullptr;
+  }
+  if (files_.size() >= kMaxFiles) files_.pop_back();
+  files_.push_front({.file_name = file_name,
+                     .size = size,
+                     .mtime = mtime,
+                     .file = file});
+  return file;
+}
+
+} // namespace sv
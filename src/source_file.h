@@ -0,0 +1,66 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "simple_tokenizer.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sv {
+
+// A source file that is mapped into memory and indexed by line, so that files
+// with millions of lines open without reading them. Lines are only tokenized
+// when they are asked for, a block of lines at a time. The tokenizer state at
+// the start of each block is kept once known, so that jumping around in the
+// file only costs the blocks that are looked at.
+class SourceFile {
+ public:
+  // Throws std::runtime_error if the file can't be read.
+  explicit SourceFile(const std::string &file_name);
+  int NumLines() const { return line_starts_.size(); }
+  // Text of a line, without the line ending.
+  std::string_view Line(int line) const;
+  // Tokenizer holding the comments, keywords and identifiers of the line. It
+  // is valid until the next call.
+  SimpleTokenizer &Tokens(int line);
+
+ private:
+  // Lines per tokenized block.
+  static constexpr int kBlockSize = 256;
+  // Number of tokenized blocks that are kept.
+  static constexpr int kMaxBlocks = 16;
+
+  MappedFile file_;
+  std::vector<uint64_t> line_starts_;
+  // Tokenizer state at the start of each block, as far as the file has been
+  // tokenized.
+  std::vector<SimpleTokenizer::State> block_states_ = {{}};
+  // Most recently used tokenized blocks, by block number, most recent first.
+  std::list<std::pair<int, SimpleTokenizer>> blocks_;
+};
+
+// Keeps the most recently shown source files open, so that going back and
+// forth between files doesn't read them again. Files are opened again if they
+// have changed on disk.
+class SourceFileCache {
+ public:
+  // Returns nullptr if the file can't be read.
+  std::shared_ptr<SourceFile> Get(const std::string &file_name);
+
+ private:
+  static constexpr int kMaxFiles = 8;
+  struct Entry {
+    std::string file_name;
+    uint64_t size;
+    int64_t mtime;
+    std::shared_ptr<SourceFile> file;
+  };
+  // Most recent first.
+  std::list<Entry> files_;
+};
+
+} // namespace sv
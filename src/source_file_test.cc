@@ -0,0 +1,71 @@
+#include "source_file.h"
+#include "gtest/gtest.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace sv {
+namespace {
+
+std::string WriteFile(const std::string &name, const std::string &contents) {
+  const std::string path = testing::TempDir() + name;
+  std::ofstream os(path, std::ios::binary);
+  os << contents;
+  return path;
+}
+
+TEST(SourceFile, Lines) {
+  SourceFile file(WriteFile("lines.sv", "module m;\r\n\nendmodule\n"));
+  ASSERT_EQ(file.NumLines(), 3);
+  EXPECT_EQ(file.Line(0), "module m;");
+  EXPECT_EQ(file.Line(1), "");
+  EXPECT_EQ(file.Line(2), "endmodule");
+  EXPECT_EQ(SourceFile(WriteFile("empty.sv", "")).NumLines(), 0);
+  EXPECT_EQ(SourceFile(WriteFile("no_newline.sv", "a\nb")).Line(1), "b");
+}
+
+TEST(SourceFile, TokensMatchWholeFile) {
+  // Block comments that span many lines, so that they cross the boundaries
+  // of the tokenized blocks.
+  std::vector<std::string> lines;
+  for (int i = 0; i < 5000; ++i) {
+    if (i % 700 == 0) {
+      lines.push_back("wire a; /* start of a comment");
+    } else if (i % 700 == 400) {
+      lines.push_back("end of it */ assign b = c;");
+    } else {
+      lines.push_back("logic x" + std::to_string(i) + ";");
+    }
+  }
+  std::string contents;
+  SimpleTokenizer expected;
+  for (const auto &line : lines) {
+    contents += line + "\n";
+    expected.ProcessLine(line);
+  }
+  SourceFile file(WriteFile("tokens.sv", contents));
+  ASSERT_EQ(file.NumLines(), lines.size());
+  // Jump around, like navigating a file would.
+  for (const int line : {4999, 10, 2450, 700, 4200, 1100, 0, 4999}) {
+    auto &tokens = file.Tokens(line);
+    EXPECT_EQ(tokens.Comments(line), expected.Comments(line)) << line;
+    EXPECT_EQ(tokens.Keywords(line), expected.Keywords(line)) << line;
+    EXPECT_EQ(tokens.Identifiers(line), expected.Identifiers(line)) << line;
+  }
+}
+
+TEST(SourceFileCache, ReusesFiles) {
+  const std::string path = WriteFile("cached.sv", "a\n");
+  SourceFileCache cache;
+  const auto file = cache.Get(path);
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(cache.Get(path), file);
+  WriteFile("cached.sv", "a\nb\n");
+  const auto changed = cache.Get(path);
+  ASSERT_NE(changed, nullptr);
+  EXPECT_EQ(changed->NumLines(), 2);
+  EXPECT_EQ(cache.Get(testing::TempDir() + "missing.sv"), nullptr);
+}
+
+} // namespace
+} // namespace sv
@@ -6,9 +6,9 @@
 #include "utils.h"
 #include "workspace.h"
 
+#include <algorithm>
 #include <curses.h>
 #include <filesystem>
-#include <fstream>
 #include <functional>
 #include <optional>
 #include <string>
@@ -29,14 +29,26 @@ namespace sv {
 namespace {
 
 constexpr int kMaxStateStackSize = 500;
+// Values are loaded for this fraction of the time range around the cursor, so
+// that moving the cursor a little doesn't need another load.
+constexpr uint64_t kValueWindowDivisor = 100;
 
-// Remove newline characters from the start or end of the string.
-void trim_string(std::string *s) { // NOLINT
-  s->erase(std::remove(s->begin(), s->end(), '\n'), s->end());
-  s->erase(std::remove(s->begin(), s->end(), '\r'), s->end());
+} // namespace
+
+SourcePanel::SourcePanel() {
+  Workspace::Get().AddWavesReloadHook(this, [this] {
+    if (wave_loader_ != nullptr) wave_loader_->Cancel();
+    // Ask for the values in view again once the waves are back.
+    loaded_signals_.clear();
+    loaded_start_time_ = 0;
+    loaded_end_time_ = 0;
+    cursor_values_.clear();
+  });
 }
 
-} // namespace
+SourcePanel::~SourcePanel() {
+  Workspace::Get().RemoveWavesReloadHook(this);
+}
 
 std::optional<std::pair<int, int>> SourcePanel::CursorLocation() const {
   if (scope_ == nullptr) return std::nullopt;
@@ -104,7 +116,7 @@ void SourcePanel::Draw() {
   SetColor(w_, kSourceHeaderPair);
   mvwaddnstr(w_, 0, 0, header_.c_str(), win_w);
 
-  if (lines_.empty()) {
+  if (NumLines() == 0) {
     SetColor(w_, kSourceTextPair);
     mvwprintw(w_, 1, 0, "Unable to open file");
     return;
@@ -121,7 +133,7 @@ void SourcePanel::Draw() {
   int sel_pos = 0; // Save selection start position.
   for (int y = 1; y < win_h; ++y) {
     int line_idx = y - 1 + scroll_row_;
-    if (line_idx >= lines_.size()) break;
+    if (line_idx >= NumLines()) break;
     const int line_num = line_idx + 1;
     const int line_num_size = NumDecimalDigits(line_num);
     const bool active = line_num >= start_line_ && line_num <= end_line_;
@@ -139,10 +151,11 @@ void SourcePanel::Draw() {
 
     // Go charachter by character, up to the window width.
     // Keep track of the current identifier, keyword and comment in the line.
-    const auto &s = lines_[line_idx];
-    const auto &keywords = tokenizer_.Keywords(line_idx);
-    const auto &identifiers = tokenizer_.Identifiers(line_idx);
-    const auto &comments = tokenizer_.Comments(line_idx);
+    const std::string_view s = file_->Line(line_idx);
+    auto &tokens = file_->Tokens(line_idx);
+    const auto &keywords = tokens.Keywords(line_idx);
+    const auto &identifiers = tokens.Identifiers(line_idx);
+    const auto &comments = tokens.Comments(line_idx);
     bool in_keyword = false;
     bool in_identifier = false;
     bool in_comment = false;
@@ -250,15 +263,12 @@ void SourcePanel::Draw() {
       // Don't bother with large arrays.
       // TODO: Is it useful to try to do something here?
       if (signals.size() == 1) {
-        const auto &wave = Workspace::Get().Waves()->Wave(signals[0]);
-        if (wave.empty()) {
-          val = "No data";
+        const std::string value = SignalValue(signals[0]);
+        if (value.empty()) {
+          val = LoadingWaves() ? "Loading" : "No data";
         } else {
-          const uint64_t idx = Workspace::Get().Waves()->FindSampleIndex(
-              Workspace::Get().WaveCursorTime(), signals[0]);
           // TODO: How to allow for other radix values?
-          val = FormatValue(wave[idx].value, Radix::kHex,
-                            /* leading_zeroes*/ false);
+          val = FormatValue(value, Radix::kHex, /* leading_zeroes*/ false);
         }
       }
     }
@@ -330,16 +340,16 @@ void SourcePanel::UIChar(int ch) {
       max_col_idx_ = col_idx_;
     } else if (col_idx_ == 0 && line_idx_ != 0) {
       line_idx_--;
-      col_idx_ = std::max(0, static_cast<int>(lines_[line_idx_].size() - 1));
+      col_idx_ = std::max(0, LineSize(line_idx_) - 1);
       max_col_idx_ = col_idx_;
     }
     break;
   case 'l':
   case 0x105: // right
-    if (col_idx_ < static_cast<int>(lines_[line_idx_].size() - 1)) {
+    if (col_idx_ < LineSize(line_idx_) - 1) {
       col_idx_++;
       max_col_idx_ = col_idx_;
-    } else if (line_idx_ < lines_.size() - 1) {
+    } else if (line_idx_ < NumLines() - 1) {
       line_idx_++;
       col_idx_ = 0;
       max_col_idx_ = 0;
@@ -355,7 +365,7 @@ void SourcePanel::UIChar(int ch) {
   case 0x168: // End
   case '$':
     // End of line
-    col_idx_ = lines_[line_idx_].size() - 1;
+    col_idx_ = LineSize(line_idx_) - 1;
     max_col_idx_ = col_idx_;
     break;
   case 'd':
@@ -374,7 +384,12 @@ void SourcePanel::UIChar(int ch) {
   case 'L':
     if (sel_ != nullptr) {
       bool trace_drivers = ch == 'D';
-      GetDriversOrLoads(sel_, trace_drivers, &drivers_or_loads_);
+      // Search the source directly until the connectivity graph is ready.
+      if (const auto *graph = Workspace::Get().Connectivity()) {
+        graph->DriversOrLoads(sel_, trace_drivers, &drivers_or_loads_);
+      } else {
+        GetDriversOrLoads(sel_, trace_drivers, &drivers_or_loads_);
+      }
       trace_idx_ = 0;
       if (!drivers_or_loads_.empty()) SetLocation(drivers_or_loads_[0]);
     }
@@ -434,21 +449,17 @@ void SourcePanel::UIChar(int ch) {
     int param_pos = -1;
     int identifier_pos = -1;
     // Look for navigable items
-    if (nav_by_line_.find(line_idx_) != nav_by_line_.end()) {
-      for (auto &item : nav_by_line_[line_idx_]) {
-        if (item.first > col_idx_) {
-          identifier_pos = item.first;
-          break;
-        }
+    for (auto &item : NavItems(line_idx_)) {
+      if (item.first > col_idx_) {
+        identifier_pos = item.first;
+        break;
       }
     }
     // Look for parameters
-    if (params_by_line_.find(line_idx_) != params_by_line_.end()) {
-      for (auto &p : params_by_line_[line_idx_]) {
-        if (p.first > col_idx_) {
-          param_pos = p.first;
-          break;
-        }
+    for (auto &p : Params(line_idx_)) {
+      if (p.first > col_idx_) {
+        param_pos = p.first;
+        break;
       }
     }
     // Pick the closest one.
@@ -473,7 +484,7 @@ void SourcePanel::UIChar(int ch) {
   // shorter. If the new line is longer, move it back to as far as it used to
   // be.
   if (line_moved) {
-    int new_line_size = lines_[line_idx_].size();
+    int new_line_size = LineSize(line_idx_);
     if (col_idx_ >= new_line_size) {
       col_idx_ = std::max(0, new_line_size - 1);
     } else {
@@ -492,24 +503,41 @@ void SourcePanel::UIChar(int ch) {
 void SourcePanel::SelectItem() {
   sel_ = nullptr;
   sel_param_.clear();
-  if (nav_by_line_.find(line_idx_) != nav_by_line_.end()) {
-    for (auto &item : nav_by_line_[line_idx_]) {
-      if (col_idx_ >= item.first &&
-          col_idx_ < (item.first + item.second->VpiName().size())) {
-        sel_ = item.second;
-        break;
-      }
+  for (auto &item : NavItems(line_idx_)) {
+    if (col_idx_ >= item.first &&
+        col_idx_ < (item.first + item.second->VpiName().size())) {
+      sel_ = item.second;
+      break;
     }
   }
-  if (params_by_line_.find(line_idx_) != params_by_line_.end()) {
-    for (auto &p : params_by_line_[line_idx_]) {
-      if (col_idx_ >= p.first && col_idx_ < (p.first + p.second.size())) {
-        sel_param_ = p.second;
-      }
+  for (auto &p : Params(line_idx_)) {
+    if (col_idx_ >= p.first && col_idx_ < (p.first + p.second.size())) {
+      sel_param_ = p.second;
     }
   }
 }
 
+std::vector<std::pair<int, const UHDM::any *>>
+SourcePanel::NavItems(int line) {
+  std::vector<std::pair<int, const UHDM::any *>> items;
+  if (line >= NumLines()) return items;
+  for (const auto &id : file_->Tokens(line).Identifiers(line)) {
+    if (params_.find(id.second) != params_.end()) continue;
+    const auto it = nav_.find(id.second);
+    if (it != nav_.end()) items.push_back({id.first, it->second});
+  }
+  return items;
+}
+
+std::vector<std::pair<int, std::string>> SourcePanel::Params(int line) {
+  std::vector<std::pair<int, std::string>> params;
+  if (line >= NumLines()) return params;
+  for (const auto &id : file_->Tokens(line).Identifiers(line)) {
+    if (params_.find(id.second) != params_.end()) params.push_back(id);
+  }
+  return params;
+}
+
 std::pair<int, int> SourcePanel::ScrollArea() const {
   // Account for the header.
   int h, w;
@@ -569,14 +597,11 @@ void SourcePanel::SetItem(const UHDM::any *item, bool show_def,
   scope_ = GetScopeForUI(item);
   showing_def_ = show_def;
   // Clear out old info.
-  lines_.clear();
+  file_ = nullptr;
   nav_.clear();
-  nav_by_line_.clear();
   params_.clear();
-  params_by_line_.clear();
   sel_ = nullptr;
   sel_param_.clear();
-  tokenizer_ = SimpleTokenizer();
   line_idx_ = 0;
   col_idx_ = 0;
   max_col_idx_ = 0;
@@ -730,64 +755,107 @@ void SourcePanel::SetItem(const UHDM::any *item, bool show_def,
       end_line_ = def->VpiEndLineNo();
     }
   }
-  // Read all lines. TODO: Handle huge files.
-  std::ifstream is(current_file_);
-  if (is.fail()) return; // Draw function handles file open issues.
-  std::string s;
-  int n = 0;
-  while (std::getline(is, s)) {
-    trim_string(&s);
-    tokenizer_.ProcessLine(s);
-    lines_.push_back(std::move(s));
-    // Add all useful identifiers in this line to the appropriate list.
-    for (auto &id : tokenizer_.Identifiers(n)) {
-      if (params_.find(id.second) != params_.end()) {
-        params_by_line_[n].push_back(id);
-      } else if (nav_.find(id.second) != nav_.end()) {
-        nav_by_line_[n].push_back({id.first, nav_[id.second]});
-      }
-    }
-    n++;
-  }
+  // Lines are only tokenized as they are shown, so this is cheap even for huge
+  // files, and more so if the file was shown recently.
+  file_ = files_.Get(current_file_);
+  // Draw function handles file open issues.
+  if (file_ == nullptr || file_->NumLines() == 0) return;
   SetLineAndScroll(line_num - 1);
   BuildHeader();
-  UpdateWaveData();
 }
 
-void SourcePanel::UpdateWaveData() {
-  if (Workspace::Get().Waves() == nullptr) return;
+std::string SourcePanel::SignalValue(const WaveData::Signal *signal) const {
+  const auto *waves = Workspace::Get().Waves();
+  const uint64_t time = Workspace::Get().WaveCursorTime();
+  if (waves->SamplesValid(signal, time, time)) {
+    return waves->FindSampleValue(time, signal);
+  }
+  if (time != cursor_values_time_) return "";
+  const auto it = cursor_values_.find(signal);
+  return it == cursor_values_.end() ? "" : it->second;
+}
+
+void SourcePanel::UpdateLoadedWaves() {
+  const auto *waves = Workspace::Get().Waves();
+  if (waves == nullptr || file_ == nullptr) return;
+  if (wave_loader_ == nullptr) {
+    wave_loader_ = std::make_unique<WaveLoader>(waves);
+  }
+  wave_loader_->Apply();
+  if (!show_vals_) return;
+  // Signals of the navigable items in view. Like when drawing values, arrays
+  // are left out.
   std::vector<const WaveData::Signal *> signals;
-  for (auto &[id, item] : nav_) {
-    auto signals_for_item = Workspace::Get().DesignToSignals(item);
-    signals.insert(signals.end(), signals_for_item.begin(),
-                   signals_for_item.end());
-  }
-  auto *waves = Workspace::Get().Waves();
-  // TODO: Loading for the full range here. Is there a way to bound it?
-  waves->LoadSignalSamples(signals, waves->TimeRange().first,
-                           waves->TimeRange().second);
+  const int end_line = std::min(NumLines(), scroll_row_ + ScrollArea().first);
+  for (int line = scroll_row_; line < end_line; ++line) {
+    for (const auto &[col, item] : NavItems(line)) {
+      const auto item_signals = Workspace::Get().DesignToSignals(item);
+      if (item_signals.size() == 1) signals.push_back(item_signals[0]);
+    }
+  }
+  std::sort(signals.begin(), signals.end());
+  signals.erase(std::unique(signals.begin(), signals.end()), signals.end());
+  const uint64_t time = Workspace::Get().WaveCursorTime();
+  // Values at the cursor itself are a quick point query, so they show while
+  // the window is still loading.
+  if (time != cursor_values_time_) {
+    cursor_values_.clear();
+    cursor_values_time_ = time;
+  }
+  std::vector<const WaveData::Signal *> unknown;
+  for (const auto *signal : signals) {
+    if (!waves->SamplesValid(signal, time, time) &&
+        !cursor_values_.contains(signal)) {
+      unknown.push_back(signal);
+    }
+  }
+  if (!unknown.empty()) {
+    std::vector<std::string> values = waves->SignalValuesAt(unknown, time);
+    for (int i = 0; i < unknown.size(); ++i) {
+      cursor_values_[unknown[i]] = std::move(values[i]);
+    }
+  }
+  if (time >= loaded_start_time_ && time <= loaded_end_time_ &&
+      std::includes(loaded_signals_.begin(), loaded_signals_.end(),
+                    signals.begin(), signals.end())) {
+    return;
+  }
+  const auto [first_time, last_time] = waves->TimeRange();
+  const uint64_t half_window =
+      std::max<uint64_t>(1, (last_time - first_time) / kValueWindowDivisor / 2);
+  loaded_start_time_ = time - std::min(time, half_window);
+  loaded_end_time_ = time + half_window;
+  loaded_signals_ = std::move(signals);
+  std::vector<const WaveData::Signal *> unloaded;
+  for (const auto *signal : loaded_signals_) {
+    if (!waves->SamplesValid(signal, loaded_start_time_, loaded_end_time_)) {
+      unloaded.push_back(signal);
+    }
+  }
+  if (unloaded.empty()) return;
+  wave_loader_->Load(unloaded, loaded_start_time_, loaded_end_time_);
 }
 
 bool SourcePanel::Search(bool search_down) {
-  if (lines_.empty()) return false;
+  if (NumLines() == 0) return false;
   if (search_text_.empty()) return false;
   int row = line_idx_;
   int col = col_idx_;
   const auto line_step = [&] {
     row += search_down ? 1 : -1;
-    if (row >= static_cast<int>(lines_.size())) {
+    if (row >= NumLines()) {
       row = 0;
     } else if (row < 0) {
-      row = lines_.size() - 1;
+      row = NumLines() - 1;
     }
-    col = search_down ? 0 : (lines_[row].size() - 1);
+    col = search_down ? 0 : (file_->Line(row).size() - 1);
   };
   if (!search_preview_) {
     // Go past the current location so that next/prev doesn't just find what's
     // under the cursor. Can't do this in preview mode otherwise the result
     // would keep jumping with every new keypress.
     if (search_down) {
-      if (col == lines_[row].size() - 1) {
+      if (col == file_->Line(row).size() - 1) {
         line_step();
         col = 0;
       } else {
@@ -796,7 +864,7 @@ bool SourcePanel::Search(bool search_down) {
     } else {
       if (col == 0) {
         line_step();
-        col = lines_[row].size() - 1;
+        col = file_->Line(row).size() - 1;
       } else {
         col--;
       }
@@ -804,8 +872,9 @@ bool SourcePanel::Search(bool search_down) {
   }
   const int start_row = row;
   while (1) {
-    const auto pos = search_down ? lines_[row].find(search_text_, col)
-                                 : lines_[row].rfind(search_text_, col);
+    const std::string_view line = file_->Line(row);
+    const auto pos = search_down ? line.find(search_text_, col)
+                                 : line.rfind(search_text_, col);
     if (pos != std::string::npos) {
       search_start_col_ = pos;
       col_idx_ = pos;
@@ -2,9 +2,12 @@
 
 #include "absl/container/flat_hash_map.h"
 #include "panel.h"
-#include "simple_tokenizer.h"
+#include "source_file.h"
+#include "wave_data.h"
+#include "wave_loader.h"
 
 #include <deque>
+#include <memory>
 #include <uhdm/uhdm_types.h>
 #include <vector>
 
@@ -13,9 +16,13 @@ namespace sv {
 // This panel displays source code for a UHDM item.
 class SourcePanel : public Panel {
  public:
+  SourcePanel();
+  ~SourcePanel() override;
   void Draw() final;
   void UIChar(int ch) final;
-  int NumLines() const final { return lines_.size(); }
+  int NumLines() const final {
+    return file_ == nullptr ? 0 : file_->NumLines();
+  }
   std::optional<std::pair<int, int>> CursorLocation() const final;
   std::vector<Tooltip> Tooltips() const final;
   void SetItem(const UHDM::any *item, bool show_def = false);
@@ -27,6 +34,15 @@ class SourcePanel : public Panel {
   // Need to look for stuff under the cursor when changing lines.
   void SetLineAndScroll(int l) final;
   void Resized() final;
+  // Values of the items in view are loaded in the background, for a window of
+  // time around the wave cursor. While this is true, the UI should call
+  // UpdateLoadedWaves() regularly, and redraw.
+  bool LoadingWaves() const {
+    return wave_loader_ != nullptr && wave_loader_->Busy();
+  }
+  // Picks up the values loaded so far, and starts loading the ones that are
+  // now in view if needed.
+  void UpdateLoadedWaves();
 
  private:
   // Push the current state onto the stack.
@@ -42,8 +58,16 @@ class SourcePanel : public Panel {
   void SelectItem();
   // Generates a nice header that probably fits in the current window width.
   void BuildHeader();
-  // Read all wave data for the nets in the current item.
-  void UpdateWaveData();
+  // Value of the signal at the wave cursor, or an empty string if it isn't
+  // known yet.
+  std::string SignalValue(const WaveData::Signal *signal) const;
+  // Length of a line, or 0 if the file couldn't be read.
+  int LineSize(int line) const {
+    return line < NumLines() ? file_->Line(line).size() : 0;
+  }
+  // Navigable items and parameters in a line, by their column.
+  std::vector<std::pair<int, const UHDM::any *>> NavItems(int line);
+  std::vector<std::pair<int, std::string>> Params(int line);
 
   // Textual representation of the current item. For things like nets the
   // containing scope is used.
@@ -60,27 +84,30 @@ class SourcePanel : public Panel {
   // The currently selected item. Could be a parameter too.
   const UHDM::any *sel_ = nullptr;
   std::string sel_param_;
-  // All source lines of the file containing the module instance containing the
-  // selected item (this could be the complete instance itself too).
+  // Loads the waves of the items in view, and what was asked for last.
+  std::unique_ptr<WaveLoader> wave_loader_;
+  std::vector<const WaveData::Signal *> loaded_signals_;
+  uint64_t loaded_start_time_ = 0;
+  uint64_t loaded_end_time_ = 0;
+  // Values at the wave cursor, read right away for the signals in view while
+  // the window around it is still loading.
+  absl::flat_hash_map<const WaveData::Signal *, std::string> cursor_values_;
+  uint64_t cursor_values_time_ = 0;
+  // The file containing the module instance containing the selected item (this
+  // could be the complete instance itself too).
   std::string current_file_;
-  std::vector<std::string> lines_;
+  std::shared_ptr<SourceFile> file_;
+  SourceFileCache files_;
   // Things in the source code that are navigable:
   // - Nets and variables. Add to wave, trace drivers/loads, go to def.
   // - Module instances: Open source
   // - Parameters: go to definition
   // These are stored in a hash by identifier so they can be appropriately
-  // syntax-highlighted. Also stored by line to allow for fast lookup under the
-  // cursor.
+  // syntax-highlighted. The identifiers of a line come from the tokens of the
+  // file.
   absl::flat_hash_map<std::string, const UHDM::any *> nav_;
-  absl::flat_hash_map<int, std::vector<std::pair<int, const UHDM::any *>>>
-      nav_by_line_;
   // Map of all textual parameters and their definitions.
   absl::flat_hash_map<std::string, std::string> params_;
-  absl::flat_hash_map<int, std::vector<std::pair<int, std::string>>>
-      params_by_line_;
-  // Tokenizer that holds identifiers and keywords for each line. This
-  // simplifies syntax highlighting for keywords and comments.
-  SimpleTokenizer tokenizer_;
   // Limits active scope, for example files with more than one module
   // definition. Text rendering uses this grey out source outside this.
   int start_line_ = 0;
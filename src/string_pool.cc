@@ -0,0 +1,33 @@
+#include "string_pool.h"
+#include <algorithm>
+#include <cstring>
+
+namespace sv {
+
+std::string_view StringPool::Intern(std::string_view s) {
+  auto it = strings_.find(s);
+  if (it != strings_.end()) return *it;
+  if (s.size() > chunk_free_) {
+    // Very long strings get a chunk of their own. The rest of the current
+    // chunk is lost then, which is rare enough not to matter.
+    const int size = std::max<int>(s.size(), kChunkSize);
+    chunks_.push_back(std::make_unique<char[]>(size));
+    next_ = chunks_.back().get();
+    chunk_free_ = size;
+  }
+  if (!s.empty()) memcpy(next_, s.data(), s.size());
+  const std::string_view interned(next_, s.size());
+  next_ += s.size();
+  chunk_free_ -= s.size();
+  strings_.insert(interned);
+  return interned;
+}
+
+void StringPool::Clear() {
+  strings_.clear();
+  chunks_.clear();
+  next_ = nullptr;
+  chunk_free_ = 0;
+}
+
+} // namespace sv
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "absl/container/flat_hash_set.h"
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace sv {
+
+// Keeps a single copy of each distinct string. Meant for names that repeat a
+// lot, such as clk or rst_n in nearly every scope of a design. The returned
+// views stay valid until the pool is cleared or destroyed.
+class StringPool {
+ public:
+  StringPool() = default;
+  StringPool(const StringPool &) = delete;
+  StringPool &operator=(const StringPool &) = delete;
+
+  std::string_view Intern(std::string_view s);
+  void Clear();
+
+ private:
+  // Strings are copied into chunks of this size, or their own allocation if
+  // they don't fit.
+  static constexpr int kChunkSize = 64 * 1024;
+
+  absl::flat_hash_set<std::string_view> strings_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  // Free space in the last chunk.
+  char *next_ = nullptr;
+  int chunk_free_ = 0;
+};
+
+} // namespace sv
@@ -1,80 +1,120 @@
 #include "tree_data.h"
-#include <functional>
 
 namespace sv {
 
-namespace {
-// Limit number of instances dumped into the UI at once.
-constexpr int kMaxExpandInstances = 100;
-} // namespace
+TreeData::LineCounts::LineCounts(const std::vector<int> &counts) {
+  tree_.resize(counts.size() + 1);
+  for (int i = 1; i <= counts.size(); ++i) {
+    tree_[i] += counts[i - 1];
+    total_ += counts[i - 1];
+    const int next = i + (i & -i);
+    if (next < tree_.size()) tree_[next] += tree_[i];
+  }
+}
 
-void TreeData::ToggleExpand(int idx) {
-  // Helper function to find the parent.
-  auto get_parent_idx = [&](int idx) {
-    const int depth = list_[idx]->Depth();
-    while (idx > 0) {
-      if (list_[idx]->Depth() < depth) {
-        return idx;
-      }
-      idx--;
-    }
-    return -1;
-  };
+void TreeData::LineCounts::Append(int count) {
+  const int i = tree_.size();
+  tree_.push_back(count + Prefix(i - 1) - Prefix(i - (i & -i)));
+  total_ += count;
+}
 
-  if (list_.empty()) return;
-  auto item = list_[idx];
-  if (item->MoreIdx() != 0) {
-    // Check if the "... more ..." entry needs to be further expanded.
-    int stopped_pos = item->MoreIdx();
-    item->SetMoreIdx(0); // Indicate it isn't a more-expander anymore.
-    std::vector<TreeItem *> new_entries;
-    auto *parent = list_[get_parent_idx(idx)];
-    for (int i = stopped_pos + 1; i < parent->NumChildren(); ++i) {
-      const int more_idx =
-          (more_enabled_ && (i - stopped_pos) >= kMaxExpandInstances) ? i : 0;
-      new_entries.push_back(parent->Child(i));
-      new_entries.back()->SetDepth(item->Depth());
-      new_entries.back()->SetMoreIdx(more_idx);
-      if (more_idx != 0) break;
-    }
-    // Insert new entries after the more-expander.
-    list_.insert(list_.begin() + idx + 1, new_entries.cbegin(),
-                 new_entries.cend());
-    return;
-  } else if (!item->Expandable()) {
-    return;
-  } else if (item->Expanded()) {
-    // Delete everything under the current index that has greater depth.
-    int last = idx + 1;
-    while (last < list_.size() && list_[last]->Depth() > item->Depth()) {
-      last++;
+void TreeData::LineCounts::Add(int idx, int delta) {
+  for (int i = idx + 1; i < tree_.size(); i += i & -i) {
+    tree_[i] += delta;
+  }
+  total_ += delta;
+}
+
+int TreeData::LineCounts::Prefix(int idx) const {
+  int sum = 0;
+  for (int i = idx; i > 0; i -= i & -i) {
+    sum += tree_[i];
+  }
+  return sum;
+}
+
+std::pair<int, int> TreeData::LineCounts::Find(int line) const {
+  int idx = 0;
+  int before = 0;
+  int step = 1;
+  while (step * 2 < tree_.size()) step *= 2;
+  for (; step > 0; step /= 2) {
+    if (idx + step < tree_.size() && before + tree_[idx + step] <= line) {
+      idx += step;
+      before += tree_[idx];
     }
-    list_.erase(list_.begin() + idx + 1, list_.begin() + last);
-    item->SetExpanded(false);
-  } else {
-    std::vector<TreeItem *> new_entries;
-    std::function<void(TreeItem *, std::vector<TreeItem *> &)>
-        recurse_add_subs = [&](TreeItem *item, std::vector<TreeItem *> &list) {
-          for (int i = 0; i < item->NumChildren(); ++i) {
-            auto child = item->Child(i);
-            list.push_back(child);
-            child->SetDepth(item->Depth() + 1);
-            // Expand anyway if there are only limited items to go.
-            if (more_enabled_ && i >= kMaxExpandInstances &&
-                (item->NumChildren() - 1) < kMaxExpandInstances) {
-              child->SetMoreIdx(i);
-              break;
-            } else if (child->Expanded()) {
-              recurse_add_subs(child, list);
-            }
-          }
-        };
-    recurse_add_subs(item, new_entries);
-    // Insert new entries after opened item
-    list_.insert(list_.begin() + idx + 1, new_entries.cbegin(),
-                 new_entries.cend());
-    item->SetExpanded(true);
   }
+  return {idx, before};
+}
+
+std::vector<TreeData::PathEntry> TreeData::Path(int idx) const {
+  std::vector<PathEntry> path;
+  TreeItem *parent = nullptr;
+  const LineCounts *counts = &root_lines_;
+  int line = 0;
+  while (true) {
+    const auto [child, before] = counts->Find(idx - line);
+    TreeItem *item = parent == nullptr ? roots_[child] : parent->Child(child);
+    line += before;
+    path.push_back({.item = item, .child = child, .line = line});
+    if (line == idx) return path;
+    line++;
+    parent = item;
+    counts = &child_lines_.at(item);
+  }
+}
+
+int TreeData::ParentIdx(int idx) const {
+  const auto path = Path(idx);
+  return path.size() < 2 ? -1 : path[path.size() - 2].line;
+}
+
+int TreeData::ChildIdx(int idx, int child) const {
+  return idx + 1 + child_lines_.at((*this)[idx]).Prefix(child);
+}
+
+const TreeData::LineCounts &TreeData::ChildLines(TreeItem *item) {
+  if (const auto it = child_lines_.find(item); it != child_lines_.end()) {
+    return it->second;
+  }
+  std::vector<int> counts(item->NumChildren());
+  for (int i = 0; i < counts.size(); ++i) {
+    auto *child = item->Child(i);
+    child->SetDepth(item->Depth() + 1);
+    counts[i] = Lines(child);
+  }
+  return child_lines_.emplace(item, LineCounts(counts)).first->second;
+}
+
+int TreeData::Lines(TreeItem *item) {
+  return 1 + (item->Expanded() ? ChildLines(item).Total() : 0);
+}
+
+void TreeData::ToggleExpand(int idx) {
+  if (Empty()) return;
+  const auto path = Path(idx);
+  auto *item = path.back().item;
+  if (!item->Expandable()) return;
+  const int delta = item->Expanded() ? -ChildLines(item).Total()
+                                     : ChildLines(item).Total();
+  item->SetExpanded(!item->Expanded());
+  // Every item on the way down takes up that many more or fewer lines.
+  for (int i = 0; i < path.size(); ++i) {
+    auto &counts = i == 0 ? root_lines_ : child_lines_.at(path[i - 1].item);
+    counts.Add(path[i].child, delta);
+  }
+}
+
+void TreeData::AddRoot(TreeItem *r) {
+  r->SetDepth(0);
+  roots_.push_back(r);
+  root_lines_.Append(Lines(r));
+}
+
+void TreeData::Clear() {
+  roots_.clear();
+  root_lines_ = LineCounts();
+  child_lines_.clear();
 }
 
 } // namespace sv
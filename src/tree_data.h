@@ -1,30 +1,72 @@
 #pragma once
 
+#include "absl/container/flat_hash_map.h"
 #include "tree_item.h"
+#include <utility>
 #include <vector>
 
 namespace sv {
 
-// Holds a representation of a tree structure as a linear list, dropping out
-// anything that hasn't been expanded. Expanding or collapsing nodes results in
-// the list being re-built.
+// Holds a representation of a tree structure as a linear list of lines,
+// leaving out anything that hasn't been expanded. The list itself is never
+// built: each expanded item keeps the number of lines that each of its
+// children takes up, in a Fenwick tree. Finding the item on a line, and
+// expanding or collapsing one, take time logarithmic in the number of lines at
+// each level down, so that items with hundreds of thousands of children can be
+// expanded in full.
 class TreeData {
  public:
-  int ListSize() const { return list_.size(); }
-  bool Empty() const { return list_.empty(); }
+  int ListSize() const { return root_lines_.Total(); }
+  bool Empty() const { return ListSize() == 0; }
   void ToggleExpand(int idx);
-  const TreeItem *operator[](int idx) const { return list_[idx]; }
-  TreeItem *operator[](int idx) { return list_[idx]; }
-  void DeleteItem(int idx) { list_.erase(list_.begin() + idx); }
-  void AddRoot(TreeItem *r) { list_.push_back(r); }
-  void Clear() { list_.clear(); }
-  void SetMoreEnable(bool b) { more_enabled_ = b; }
+  const TreeItem *operator[](int idx) const { return Path(idx).back().item; }
+  TreeItem *operator[](int idx) { return Path(idx).back().item; }
+  // Line of the item that the one on the line is a child of, or -1 for roots.
+  int ParentIdx(int idx) const;
+  // Line of a child of the expanded item on the line.
+  int ChildIdx(int idx, int child) const;
+  // Line of a root.
+  int RootIdx(int root) const { return root_lines_.Prefix(root); }
+  void AddRoot(TreeItem *r);
+  void Clear();
 
  private:
+  // Numbers of lines taken up by each of a list of items.
+  class LineCounts {
+   public:
+    LineCounts() = default;
+    explicit LineCounts(const std::vector<int> &counts);
+    void Append(int count);
+    void Add(int idx, int delta);
+    // Lines taken up by the items before the index.
+    int Prefix(int idx) const;
+    int Total() const { return total_; }
+    // Index of the item that takes up the line, and the lines before it.
+    std::pair<int, int> Find(int line) const;
+
+   private:
+    // One-based, each entry holding the sum of the lowest set bit of its
+    // index worth of counts, up to and including its own.
+    std::vector<int> tree_ = {0};
+    int total_ = 0;
+  };
+  // An item on the way down to a line, as the child of the one before it.
+  struct PathEntry {
+    TreeItem *item;
+    int child;
+    int line;
+  };
+  std::vector<PathEntry> Path(int idx) const;
+  // Lines of the children of an item, counted the first time it is expanded.
+  // They are kept when it is collapsed, since nothing below it can change
+  // until it is expanded again.
+  const LineCounts &ChildLines(TreeItem *item);
+  int Lines(TreeItem *item);
+
   // TreeItem is an abstract class, so gotta use pointers.
-  std::vector<TreeItem *> list_;
-  // Limit number of children expanded at any one time.
-  bool more_enabled_ = true;
+  std::vector<TreeItem *> roots_;
+  LineCounts root_lines_;
+  absl::flat_hash_map<const TreeItem *, LineCounts> child_lines_;
 };
 
 } // namespace sv
@@ -0,0 +1,115 @@
+#include "tree_data.h"
+#include "gtest/gtest.h"
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace sv {
+namespace {
+
+class Item : public TreeItem {
+ public:
+  explicit Item(const std::string &name) : name_(name) {}
+  const std::string &Name() const final { return name_; }
+  const std::string &Type() const final { return name_; }
+  bool AltType() const final { return false; }
+  bool Expandable() const final { return !children_.empty(); }
+  int NumChildren() const final { return children_.size(); }
+  TreeItem *Child(int idx) final { return children_[idx].get(); }
+  Item *Add(const std::string &name) {
+    children_.push_back(std::make_unique<Item>(name));
+    return children_.back().get();
+  }
+
+ private:
+  std::string name_;
+  std::vector<std::unique_ptr<Item>> children_;
+};
+
+// What the tree shows, the slow way.
+void Flatten(TreeItem *item, std::vector<TreeItem *> *list) {
+  list->push_back(item);
+  if (!item->Expanded()) return;
+  for (int i = 0; i < item->NumChildren(); ++i) {
+    Flatten(item->Child(i), list);
+  }
+}
+
+TEST(TreeData, ExpandAndCollapse) {
+  Item top("top");
+  Item *a = top.Add("a");
+  a->Add("a0");
+  a->Add("a1");
+  top.Add("b");
+  Item other("other");
+  TreeData data;
+  data.AddRoot(&top);
+  data.AddRoot(&other);
+  ASSERT_EQ(data.ListSize(), 2);
+  data.ToggleExpand(0);
+  ASSERT_EQ(data.ListSize(), 4);
+  data.ToggleExpand(1);
+  ASSERT_EQ(data.ListSize(), 6);
+  const std::vector<std::string> names = {"top", "a", "a0", "a1", "b", "other"};
+  const std::vector<int> depths = {0, 1, 2, 2, 1, 0};
+  const std::vector<int> parents = {-1, 0, 1, 1, 0, -1};
+  for (int i = 0; i < names.size(); ++i) {
+    EXPECT_EQ(data[i]->Name(), names[i]);
+    EXPECT_EQ(data[i]->Depth(), depths[i]);
+    EXPECT_EQ(data.ParentIdx(i), parents[i]);
+  }
+  EXPECT_EQ(data.ChildIdx(0, 1), 4);
+  EXPECT_EQ(data.ChildIdx(1, 1), 3);
+  EXPECT_EQ(data.RootIdx(1), 5);
+  // What is expanded below stays that way.
+  data.ToggleExpand(0);
+  ASSERT_EQ(data.ListSize(), 2);
+  EXPECT_EQ(data[1]->Name(), "other");
+  data.ToggleExpand(0);
+  ASSERT_EQ(data.ListSize(), 6);
+  EXPECT_EQ(data[3]->Name(), "a1");
+  // Items that can't be expanded are left alone.
+  data.ToggleExpand(2);
+  EXPECT_EQ(data.ListSize(), 6);
+}
+
+TEST(TreeData, MatchesFlatList) {
+  std::mt19937 rng(1);
+  std::vector<std::unique_ptr<Item>> roots;
+  std::vector<Item *> all;
+  for (int i = 0; i < 3; ++i) {
+    roots.push_back(std::make_unique<Item>("r" + std::to_string(i)));
+    all.push_back(roots.back().get());
+  }
+  for (int i = 0; i < 2000; ++i) {
+    Item *parent = all[rng() % all.size()];
+    all.push_back(parent->Add(std::to_string(i)));
+  }
+  TreeData data;
+  for (auto &root : roots) data.AddRoot(root.get());
+  for (int step = 0; step < 500; ++step) {
+    data.ToggleExpand(rng() % data.ListSize());
+    std::vector<TreeItem *> expected;
+    for (auto &root : roots) Flatten(root.get(), &expected);
+    ASSERT_EQ(data.ListSize(), expected.size());
+    for (int i = 0; i < 10; ++i) {
+      const int idx = rng() % expected.size();
+      ASSERT_EQ(data[idx], expected[idx]);
+    }
+  }
+}
+
+TEST(TreeData, ManyChildren) {
+  Item top("top");
+  for (int i = 0; i < 500'000; ++i) top.Add(std::to_string(i));
+  TreeData data;
+  data.AddRoot(&top);
+  data.ToggleExpand(0);
+  ASSERT_EQ(data.ListSize(), 500'001);
+  EXPECT_EQ(data[500'000]->Name(), "499999");
+  EXPECT_EQ(data.ParentIdx(250'000), 0);
+}
+
+} // namespace
+} // namespace sv
@@ -21,72 +21,67 @@ void TreePanel::Draw() {
     }
     auto item = data_[list_idx];
     std::string indent(item->Depth(), ' ');
-    if (item->MoreIdx() != 0) {
-      SetColor(w_, kHierShowMorePair);
-      mvwprintw(w_, y, 0, "%s...more...", indent.c_str());
-    } else {
-      const std::string &type_name = item->Type();
-      const std::string &name = item->Name();
-      char exp = item->Expandable() ? (item->Expanded() ? '-' : '+') : ' ';
-      std::string s = indent;
-      if (show_expanders_) s += exp;
-      if (prepend_type_) {
-        if (type_name.empty()) {
-          s += name;
-        } else {
-          s += type_name;
-          s += " ";
-          s += name;
-        }
-      } else {
+    const std::string &type_name = item->Type();
+    const std::string &name = item->Name();
+    char exp = item->Expandable() ? (item->Expanded() ? '-' : '+') : ' ';
+    std::string s = indent;
+    if (show_expanders_) s += exp;
+    if (prepend_type_) {
+      if (type_name.empty()) {
         s += name;
-        s += " ";
+      } else {
         s += type_name;
+        s += " ";
+        s += name;
       }
-      max_string_len = std::max(max_string_len, static_cast<int>(s.size()));
-      int expand_pos = indent.size();
-      int text_pos = expand_pos + show_expanders_;
-      int inst_pos =
-          text_pos + (prepend_type_
-                          ? (type_name.empty() ? 0 : (type_name.size() + 1))
-                          : 0);
-      int type_pos = text_pos + (prepend_type_ ? 0 : (name.size() + 1));
-      const bool show_search =
-          search_preview_ && list_idx == line_idx_ && search_start_col_ >= 0;
-      const int search_pos = search_start_col_ + inst_pos;
-      for (int j = 0; j < s.size(); ++j) {
-        const int x = j - ui_col_scroll_;
-        if (x < 0) continue;
-        if (x >= win_w) break;
-        if (x == 0 && ui_col_scroll_ != 0 && j >= expand_pos) {
-          // Show an overflow character on the left edge if the ui has been
-          // scrolled horizontally.
-          SetColor(w_, kOverflowTextPair);
-          mvwaddch(w_, y, x, '<');
-        } else if (x == win_w - 1 && j < s.size() - 1) {
-          // Replace the last character with an overflow indicator if the line
-          // extends beyond the window width.
-          SetColor(w_, kOverflowTextPair);
-          mvwaddch(w_, y, x, '>');
-        } else {
-          if (j >= type_pos && j < type_pos + type_name.size()) {
-            const auto color = item->ErrType()   ? kHierErrPair
-                               : item->AltType() ? kHierOtherPair
-                                                 : kHierTypePair;
-            SetColor(w_, color);
-          } else if (j >= inst_pos) {
-            if (show_search && j == search_pos) {
-              wattron(w_, A_REVERSE);
-            }
-            SetColor(w_,
-                     item->MatchColor() ? kHierMatchedNamePair : kHierNamePair);
-          } else if (j == expand_pos && item->Expandable()) {
-            SetColor(w_, kHierExpandPair);
-          }
-          mvwaddch(w_, y, x, s[j]);
-          if (show_search && j == search_pos + search_text_.size() - 1) {
-            wattroff(w_, A_REVERSE);
+    } else {
+      s += name;
+      s += " ";
+      s += type_name;
+    }
+    max_string_len = std::max(max_string_len, static_cast<int>(s.size()));
+    int expand_pos = indent.size();
+    int text_pos = expand_pos + show_expanders_;
+    int inst_pos =
+        text_pos + (prepend_type_
+                        ? (type_name.empty() ? 0 : (type_name.size() + 1))
+                        : 0);
+    int type_pos = text_pos + (prepend_type_ ? 0 : (name.size() + 1));
+    const bool show_search =
+        search_preview_ && list_idx == line_idx_ && search_start_col_ >= 0;
+    const int search_pos = search_start_col_ + inst_pos;
+    for (int j = 0; j < s.size(); ++j) {
+      const int x = j - ui_col_scroll_;
+      if (x < 0) continue;
+      if (x >= win_w) break;
+      if (x == 0 && ui_col_scroll_ != 0 && j >= expand_pos) {
+        // Show an overflow character on the left edge if the ui has been
+        // scrolled horizontally.
+        SetColor(w_, kOverflowTextPair);
+        mvwaddch(w_, y, x, '<');
+      } else if (x == win_w - 1 && j < s.size() - 1) {
+        // Replace the last character with an overflow indicator if the line
+        // extends beyond the window width.
+        SetColor(w_, kOverflowTextPair);
+        mvwaddch(w_, y, x, '>');
+      } else {
+        if (j >= type_pos && j < type_pos + type_name.size()) {
+          const auto color = item->ErrType()   ? kHierErrPair
+                             : item->AltType() ? kHierOtherPair
+                                               : kHierTypePair;
+          SetColor(w_, color);
+        } else if (j >= inst_pos) {
+          if (show_search && j == search_pos) {
+            wattron(w_, A_REVERSE);
           }
+          SetColor(w_,
+                   item->MatchColor() ? kHierMatchedNamePair : kHierNamePair);
+        } else if (j == expand_pos && item->Expandable()) {
+          SetColor(w_, kHierExpandPair);
+        }
+        mvwaddch(w_, y, x, s[j]);
+        if (show_search && j == search_pos + search_text_.size() - 1) {
+          wattroff(w_, A_REVERSE);
         }
       }
     }
@@ -98,11 +93,9 @@ void TreePanel::Draw() {
 void TreePanel::UIChar(int ch) {
   switch (ch) {
   case 'u': {
-    int current_depth = data_[line_idx_]->Depth();
-    if (current_depth != 0 && line_idx_ != 0) {
-      while (data_[line_idx_]->Depth() >= current_depth && line_idx_ > 0) {
-        line_idx_--;
-      }
+    const int parent_idx = data_.ParentIdx(line_idx_);
+    if (parent_idx >= 0) {
+      line_idx_ = parent_idx;
       if (line_idx_ - scroll_row_ < 0) {
         scroll_row_ = line_idx_;
       }
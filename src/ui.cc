@@ -4,11 +4,14 @@
 #include "color.h"
 #include "utils.h"
 #include "workspace.h"
+#include <algorithm>
 #include <ncurses.h>
+#include <stdexcept>
 
 namespace sv {
 namespace {
 const Tooltip kHelpTT = {.hotkeys = "?", .description = "help"};
+constexpr int kLoadingUpdateMs = 100;
 }
 
 void UI::CalcLayout(bool update_frac) {
@@ -71,6 +74,7 @@ void UI::UpdateTooltips() {
          .description =
              std::string(layout_.show_wave_picker ? "SHOW/hide" : "show/HIDE") +
              " picker"});
+    tooltips_.push_back({"C-f", "find signal"});
   }
   if (panels_[focused_panel_idx_]->Searchable()) {
     tooltips_.push_back({"/nN", "search"});
@@ -118,8 +122,6 @@ UI::UI() : search_box_("/") {
   noecho();
   nonl(); // don't translate the enter key
   SetupColors();
-  // TODO - async needed?
-  // halfdelay(3); // Update async things every 300ms.
 
   // Create all UI panels.
   layout_.has_design = Workspace::Get().Design() != nullptr;
@@ -147,6 +149,7 @@ UI::UI() : search_box_("/") {
   UpdateTooltips();
   CalcLayout();
   LayoutPanels();
+  UpdateLoadedWaves();
   Draw();
 }
 
@@ -155,6 +158,26 @@ UI::~UI() {
   endwin();
 }
 
+void UI::UpdateLoadedWaves() {
+  if (waves_panel_ == nullptr) return;
+  bool loading = true;
+  try {
+    waves_panel_->UpdateLoadedWaves();
+    loading = waves_panel_->LoadingWaves();
+    if (source_panel_ != nullptr) {
+      source_panel_->UpdateLoadedWaves();
+      loading = loading || source_panel_->LoadingWaves();
+    }
+  } catch (const std::exception &e) {
+    // Reading the wave file failed, possibly in the background. Whatever was
+    // read up to that point can still be shown.
+    error_message_ = e.what();
+  }
+  // Don't wait for keys indefinitely while waves are still being loaded, so
+  // that they can be picked up and drawn as they arrive.
+  timeout(loading ? kLoadingUpdateMs : -1);
+}
+
 void UI::EventLoop() {
   while (int ch = getch()) {
     bool quit = false;
@@ -165,7 +188,8 @@ void UI::EventLoop() {
     }
 
     if (ch == ERR) {
-      // TODO: Update async things?
+      // Timed out waiting for a key, there is nothing else to do but pick up
+      // what's been loaded in the background.
     } else if (ch == KEY_RESIZE) {
       CalcLayout();
       LayoutPanels();
@@ -263,6 +287,20 @@ void UI::EventLoop() {
           }
           LayoutPanels();
           break;
+        case 0x6: // ctrl-F
+          // Find signals in all scopes, from wherever the focus is.
+          if (wave_signals_panel_ == nullptr) break;
+          layout_.show_wave_picker = true;
+          focused_panel->SetFocus(false);
+          focused_panel_idx_ =
+              std::find(panels_.begin(), panels_.end(),
+                        wave_signals_panel_.get()) -
+              panels_.begin();
+          wave_signals_panel_->SetFocus(true);
+          wave_signals_panel_->StartFind();
+          LayoutPanels();
+          UpdateTooltips();
+          break;
         case 0x9:     // tab
         case 0x161: { // shift-tab
           const bool fwd = ch == 0x9;
@@ -332,6 +370,7 @@ void UI::EventLoop() {
       }
     }
     if (quit) break;
+    UpdateLoadedWaves();
     Draw();
   }
 }
@@ -383,6 +422,8 @@ void UI::DrawHelp(int panel_idx) const {
 
 void UI::Draw() const {
   erase();
+  // Keep what's about to be drawn when loading more waves.
+  if (const auto *waves = Workspace::Get().Waves()) waves->KeepWavesInUse();
   const auto *focused_panel = panels_[focused_panel_idx_];
   // Render the dividing lines
   int term_w, term_h;
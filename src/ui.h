@@ -28,6 +28,8 @@ class UI {
   void LayoutPanels();
   void CycleFocus(bool fwd);
   void UpdateTooltips();
+  // Picks up waves loaded in the background.
+  void UpdateLoadedWaves();
   void Draw() const;
   void DrawHelp(int panel_idx) const;
 
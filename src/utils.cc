@@ -1,7 +1,14 @@
 #include "utils.h"
 #include "absl/strings/str_format.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <filesystem>
+#include <limits>
 #include <optional>
+#include <thread>
+#include <vector>
 #include <wordexp.h>
 
 namespace sv {
@@ -78,6 +85,32 @@ std::optional<uint64_t> ParseTime(const std::string &s, int smallest_unit) {
   return std::nullopt;
 }
 
+std::optional<uint64_t> ParseMemorySize(const std::string &s) {
+  if (s.empty()) return std::nullopt;
+  int shift = 0;
+  std::string digits = s;
+  switch (std::tolower(s.back())) {
+  case 'k': shift = 10; break;
+  case 'm': shift = 20; break;
+  case 'g': shift = 30; break;
+  case 't': shift = 40; break;
+  }
+  if (shift != 0) digits.pop_back();
+  if (digits.empty() ||
+      !std::all_of(digits.begin(), digits.end(), ::isdigit)) {
+    return std::nullopt;
+  }
+  try {
+    const uint64_t val = std::stoull(digits);
+    if (val > (std::numeric_limits<uint64_t>::max() >> shift)) {
+      return std::nullopt;
+    }
+    return val << shift;
+  } catch (std::exception &e) {
+  }
+  return std::nullopt;
+}
+
 std::optional<std::string> ActualFileName(const std::string &file_name) {
   wordexp_t results;
   // Don't run any commands, that's weird in this context.
@@ -90,4 +123,43 @@ std::optional<std::string> ActualFileName(const std::string &file_name) {
   if (!std::filesystem::exists(expanded_name)) return std::nullopt;
   return expanded_name;
 }
+
+void ParallelFor(int n, const std::function<void(int)> &fn,
+                 const std::function<void()> &poll) {
+  std::vector<std::exception_ptr> errors(n);
+  std::atomic<int> next = 0;
+  std::atomic<int> done = 0;
+  auto worker = [&] {
+    while (true) {
+      const int i = next++;
+      if (i >= n) return;
+      try {
+        fn(i);
+      } catch (...) {
+        errors[i] = std::current_exception();
+      }
+      done++;
+    }
+  };
+  const int num_threads =
+      std::min<int>(n, std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::thread> threads;
+  for (int i = poll ? 0 : 1; i < num_threads; ++i) {
+    threads.emplace_back(worker);
+  }
+  if (poll) {
+    while (done < n) {
+      poll();
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+  } else {
+    worker();
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  for (const auto &e : errors) {
+    if (e) std::rethrow_exception(e);
+  }
+}
 } // namespace sv
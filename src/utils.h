@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <optional>
 #include <string>
 
@@ -19,8 +20,20 @@ std::string AddDigitSeparators(uint64_t val);
 // If the string doesn't contain any specific units, the default units are used.
 std::optional<uint64_t> ParseTime(const std::string &s, int smallest_unit);
 
+// Parses a size in bytes, optionally with a K, M, G or T suffix for binary
+// multiples, as in "512M" or "4G".
+std::optional<uint64_t> ParseMemorySize(const std::string &s);
+
 // Return nullopt if the file doesn't exist, otherwise the true path accounting
 // for expanded home directory tilde and environment variables.
 std::optional<std::string> ActualFileName(const std::string &file_name);
 
+// Runs fn(i) for every i in [0, n) spread over all available cores, handing
+// out the indices in increasing order. If poll is given, the calling thread
+// runs it periodically until all work is done, otherwise it helps with the
+// work. An exception from fn is rethrown once everything finished, the one
+// for the lowest index if there are several.
+void ParallelFor(int n, const std::function<void(int)> &fn,
+                 const std::function<void()> &poll = nullptr);
+
 } // namespace sv
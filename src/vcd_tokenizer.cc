@@ -1,51 +1,64 @@
 #include "vcd_tokenizer.h"
-#include <filesystem>
-#include <fstream>
-#include <memory>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace sv {
 namespace {
 inline bool is_whitespace(char ch) {
   return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
 }
-} // namespace
 
-VcdTokenizer::VcdTokenizer(const std::string &file_name) {
-  in_ = std::make_unique<std::ifstream>(file_name);
-  if (!in_->is_open()) {
-    throw std::runtime_error("Unable to read VCD file.");
+// Returns the position of the first character at or after pos that is
+// whitespace (or not, depending on the flag), or the text size if there is
+// none. Most tokens are short, but wide bus values can be thousands of
+// characters, so scanning happens 16 bytes at a time where possible.
+uint64_t Scan(std::string_view text, uint64_t pos, bool find_whitespace) {
+  const uint64_t size = text.size();
+  const char *data = text.data();
+#if defined(__SSE2__)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  while (pos + 16 <= size) {
+    const __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+    const __m128i ws =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space),
+                                  _mm_cmpeq_epi8(chunk, tab)),
+                     _mm_or_si128(_mm_cmpeq_epi8(chunk, newline),
+                                  _mm_cmpeq_epi8(chunk, carriage_return)));
+    int mask = _mm_movemask_epi8(ws);
+    if (!find_whitespace) mask = ~mask & 0xffff;
+    if (mask != 0) return pos + __builtin_ctz(mask);
+    pos += 16;
   }
-  file_size_ = std::filesystem::file_size(file_name);
-}
-
-int VcdTokenizer::PosPercentage() const {
-  return 100 * chars_read_ / file_size_;
+#endif
+  while (pos < size && is_whitespace(data[pos]) != find_whitespace) {
+    pos++;
+  }
+  return pos;
 }
 
-bool VcdTokenizer::Eof() const { return in_->eof(); }
-
-std::streampos VcdTokenizer::Position() const { return in_->tellg(); }
+} // namespace
 
-void VcdTokenizer::SetPosition(const std::streampos &pos) {
-  // Failbit is set by get() when reading end of file, so have to clear state
-  // in order for seekg to work.
-  if (in_->eof()) in_->clear();
-  in_->seekg(pos);
-  chars_read_ = pos;
+int VcdTokenizer::PosPercentage() const {
+  if (text_.empty()) return 100;
+  return 100 * pos_ / text_.size();
 }
 
-std::string VcdTokenizer::Token() {
-  std::string tok;
-  char ch;
-  while (true) {
-    ch = in_->get();
-    chars_read_++;
-    if (in_->eof()) return tok;
-    // Skip past leading whitespace
-    if (tok.empty() && is_whitespace(ch)) continue;
-    if (is_whitespace(ch)) return tok;
-    tok += ch;
+std::string_view VcdTokenizer::Token() {
+  // Skip past leading whitespace. It's usually just a single newline or space,
+  // so check that before firing up the wide scan.
+  if (pos_ < text_.size() && is_whitespace(text_[pos_])) pos_++;
+  if (pos_ < text_.size() && is_whitespace(text_[pos_])) {
+    pos_ = Scan(text_, pos_, /*find_whitespace*/ false);
   }
+  if (pos_ >= text_.size()) return {};
+  const uint64_t start = pos_;
+  pos_ = Scan(text_, pos_, /*find_whitespace*/ true);
+  return text_.substr(start, pos_ - start);
 }
 
 } // namespace sv
@@ -1,25 +1,29 @@
 #pragma once
 
-#include <fstream>
-#include <memory>
-#include <string>
+#include <cstdint>
+#include <string_view>
 
 namespace sv {
 
-// Reads token from a VCD file.
+// Reads tokens from VCD text. The tokenizer doesn't own the text, it is
+// normally a memory mapped file (see MappedFile), and tokens are returned as
+// views straight into it. The text must outlive the tokenizer and any tokens
+// obtained from it.
 class VcdTokenizer {
  public:
-  explicit VcdTokenizer(const std::string &file_name);
-  bool Eof() const;
-  std::streampos Position() const;
-  void SetPosition(const std::streampos &pos);
+  VcdTokenizer() = default;
+  explicit VcdTokenizer(std::string_view text) : text_(text) {}
+  bool Eof() const { return pos_ >= text_.size(); }
+  uint64_t Position() const { return pos_; }
+  void SetPosition(uint64_t pos) { pos_ = pos; }
   int PosPercentage() const;
-  std::string Token();
+  // Returns the next whitespace delimited token, or an empty view if there are
+  // no more tokens.
+  std::string_view Token();
 
  private:
-  uint64_t file_size_;
-  uint64_t chars_read_ = 0;
-  std::unique_ptr<std::ifstream> in_;
+  std::string_view text_;
+  uint64_t pos_ = 0;
 };
 
 } // namespace sv
@@ -0,0 +1,58 @@
+#include "vcd_tokenizer.h"
+#include "gtest/gtest.h"
+#include <string>
+
+namespace sv {
+namespace {
+
+TEST(VcdTokenizer, BasicTokens) {
+  const std::string text = "$scope module top $end\n"
+                           "\t$var wire 8 # data [7:0] $end\r\n"
+                           "#100\n"
+                           "b1010 #\n"
+                           "1!";
+  VcdTokenizer tk(text);
+  const std::vector<std::string> expected = {
+      "$scope", "module", "top",  "$end",  "$var",  "wire",
+      "8",      "#",      "data", "[7:0]", "$end",  "#100",
+      "b1010",  "#",      "1!"};
+  for (const auto &e : expected) {
+    EXPECT_FALSE(tk.Eof());
+    EXPECT_EQ(tk.Token(), e);
+  }
+  EXPECT_TRUE(tk.Eof());
+  EXPECT_TRUE(tk.Token().empty());
+}
+
+TEST(VcdTokenizer, LongTokensAndWhitespaceRuns) {
+  // Make tokens and whitespace runs that straddle the 16-byte scan chunks.
+  std::string text;
+  std::vector<std::string> expected;
+  for (int len = 1; len < 70; ++len) {
+    expected.push_back(std::string(len, 'a' + len % 26));
+    text += std::string(1 + len % 37, len % 2 ? ' ' : '\n');
+    text += expected.back();
+  }
+  text += std::string(40, ' ');
+  VcdTokenizer tk(text);
+  for (const auto &e : expected) {
+    EXPECT_EQ(tk.Token(), e);
+  }
+  EXPECT_TRUE(tk.Token().empty());
+  EXPECT_TRUE(tk.Eof());
+  EXPECT_EQ(tk.PosPercentage(), 100);
+}
+
+TEST(VcdTokenizer, Position) {
+  const std::string text = "#0 1! #5 0!";
+  VcdTokenizer tk(text);
+  EXPECT_EQ(tk.Token(), "#0");
+  const uint64_t pos = tk.Position();
+  EXPECT_EQ(tk.Token(), "1!");
+  EXPECT_EQ(tk.Token(), "#5");
+  tk.SetPosition(pos);
+  EXPECT_EQ(tk.Token(), "1!");
+}
+
+} // namespace
+} // namespace sv
@@ -1,7 +1,12 @@
 #include "vcd_wave_data.h"
+#include <algorithm>
+#include <charconv>
+#include <limits>
 #include <stdexcept>
+#include <thread>
 
 #include "absl/strings/match.h"
+#include "utils.h"
 
 namespace sv {
 namespace {
@@ -9,25 +14,212 @@ std::runtime_error MakeParseError(const std::string &s) {
   const std::string msg = "VCD file parsing error, file malformed: ";
   return std::runtime_error(msg + s);
 }
+
+// Parse a decimal number at the start of the string. Returns the number of
+// characters consumed, zero meaning there was no number.
+template <typename T>
+int ParseNumber(std::string_view s, T *val) {
+  const auto result = std::from_chars(s.data(), s.data() + s.size(), *val);
+  if (result.ec != std::errc()) return 0;
+  return result.ptr - s.data();
+}
+
+// The value change section is indexed in chunks of roughly this many bytes.
+// They are parsed in parallel, and are the granularity at which samples for a
+// time range are loaded.
+constexpr uint64_t kMinChunkSize = 1 << 20;
+constexpr uint64_t kMaxChunkSize = 16 << 20;
+
+// Returns the position of the first line at or after pos that starts with a
+// time command, or the text size if there is none. A '#' at the start of a line
+// can also be the identifier code of a vector value on the previous line, so
+// those are skipped. Note that a '#' line inside a $comment in the value change
+// section would still be mistaken for a time command.
+uint64_t NextTimeLine(std::string_view text, uint64_t pos) {
+  while (pos < text.size()) {
+    pos = text.find("\n#", pos);
+    if (pos == std::string_view::npos) return text.size();
+    auto line_start = text.rfind('\n', pos - 1);
+    line_start = line_start == std::string_view::npos ? 0 : line_start + 1;
+    const auto prev_line = text.substr(line_start, pos - line_start);
+    pos++;
+    const bool prev_is_lone_vector =
+        !prev_line.empty() && prev_line.find(' ') == std::string_view::npos &&
+        (prev_line[0] == 'b' || prev_line[0] == 'B' || prev_line[0] == 'r' ||
+         prev_line[0] == 'R');
+    if (!prev_is_lone_vector) return pos;
+  }
+  return text.size();
+}
+
+// Bump this when changing what goes into the cache.
+constexpr uint32_t kCacheVersion = 1;
+
+void WriteCachedScope(const WaveData::SignalScope &scope,
+                      WaveCacheWriter *cache) {
+  cache->WriteString(scope.name);
+  cache->Write<uint64_t>(scope.signals.size());
+  for (const auto &s : scope.signals) {
+    cache->WriteString(s.name);
+    cache->Write<int>(s.width);
+    cache->Write<int>(s.lsb);
+    cache->Write<uint8_t>(s.has_suffix);
+    cache->Write<uint32_t>(s.id);
+  }
+  cache->Write<uint64_t>(scope.children.size());
+  for (const auto &child : scope.children) {
+    WriteCachedScope(child, cache);
+  }
+}
+
 } // namespace
 
-// Default: print.
-bool VcdWaveData::print_progress_ = true;
+bool VcdWaveData::use_cache_ = true;
 
 VcdWaveData::VcdWaveData(const std::string &file_name, bool keep_glitches)
-    : WaveData(file_name, keep_glitches), tokenizer_(VcdTokenizer(file_name)) {
-  Parse();
+    : WaveData(file_name, keep_glitches),
+      file_(std::make_unique<MappedFile>(file_name,
+                                         /*sequential_access*/ true)),
+      tokenizer_(file_->Data()) {
+  ParseOrReadCache();
+}
+
+VcdWaveData::~VcdWaveData() { StopIndexing(); }
+
+std::pair<uint64_t, uint64_t> VcdWaveData::TimeRange() const {
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  return time_range_;
+}
+
+bool VcdWaveData::Loading() const {
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  if (index_error_) {
+    std::exception_ptr error = index_error_;
+    index_error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+  return indexing_;
 }
 
 void VcdWaveData::Reload() {
-  VcdWaveData::PrintLoadProgress(false);
+  StopIndexing();
   // Re-load the file and reparse.
-  tokenizer_ = VcdTokenizer(file_name_);
+  file_ = std::make_unique<MappedFile>(file_name_,
+                                       /*sequential_access*/ true);
+  tokenizer_ = VcdTokenizer(file_->Data());
   waves_.clear();
-  roots_.clear();
+  ClearHierarchy();
+  signal_id_by_code_.clear();
+  width_by_id_.clear();
+  current_id_ = 0;
+  ParseOrReadCache();
+}
+
+void VcdWaveData::ParseOrReadCache() {
+  if (use_cache_ && ReadCache()) return;
+  // This also starts indexing, which saves the cache once done.
   Parse();
 }
 
+bool VcdWaveData::ReadCache() {
+  WaveCacheReader cache;
+  if (!cache.Open(file_name_, kCacheVersion)) return false;
+  try {
+    time_units_ = cache.Read<int>();
+    time_range_.first = cache.Read<uint64_t>();
+    time_range_.second = cache.Read<uint64_t>();
+    width_by_id_ = cache.ReadVector<int>();
+    current_id_ = width_by_id_.size();
+    const uint64_t num_codes = cache.Read<uint64_t>();
+    for (uint64_t i = 0; i < num_codes; ++i) {
+      const auto code = cache.ReadString();
+      const uint32_t id = cache.Read<uint32_t>();
+      if (id >= current_id_) {
+        throw std::runtime_error("Inconsistent wave cache");
+      }
+      signal_id_by_code_.emplace(code, id);
+    }
+    const uint64_t num_roots = cache.Read<uint64_t>();
+    for (uint64_t i = 0; i < num_roots; ++i) {
+      ReadCachedScope(&cache);
+    }
+    FinishHierarchy();
+    chunk_index_.resize(cache.Read<uint64_t>());
+    for (auto &chunk : chunk_index_) {
+      chunk.begin = cache.Read<uint64_t>();
+      chunk.end = cache.Read<uint64_t>();
+      chunk.start_time = cache.Read<uint64_t>();
+      chunk.present = cache.ReadVector<uint64_t>();
+      if (chunk.present.size() != IdBitmapSize() ||
+          chunk.end > file_->Size()) {
+        throw std::runtime_error("Inconsistent wave cache");
+      }
+    }
+    if (!cache.AtEnd()) throw std::runtime_error("Inconsistent wave cache");
+  } catch (const std::exception &e) {
+    // Fall back to parsing the file.
+    ClearHierarchy();
+    signal_id_by_code_.clear();
+    width_by_id_.clear();
+    chunk_index_.clear();
+    current_id_ = 0;
+    return false;
+  }
+  // The cached index is complete.
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  num_indexed_ = chunk_index_.size();
+  indexed_end_time_ = time_range_.second;
+  return true;
+}
+
+void VcdWaveData::ReadCachedScope(WaveCacheReader *cache) {
+  BeginScope(cache->ReadString());
+  const uint64_t num_signals = cache->Read<uint64_t>();
+  for (uint64_t i = 0; i < num_signals; ++i) {
+    auto &s = *AddSignal(cache->ReadString());
+    s.width = cache->Read<int>();
+    s.lsb = cache->Read<int>();
+    s.has_suffix = cache->Read<uint8_t>() != 0;
+    s.id = cache->Read<uint32_t>();
+    if (s.id >= current_id_) {
+      throw std::runtime_error("Inconsistent wave cache");
+    }
+    // VCD files don't have this info.
+    s.type = Signal::kNet;
+    s.direction = Signal::kInternal;
+  }
+  const uint64_t num_children = cache->Read<uint64_t>();
+  for (uint64_t i = 0; i < num_children; ++i) {
+    ReadCachedScope(cache);
+  }
+  EndScope();
+}
+
+void VcdWaveData::WriteCache() const {
+  WaveCacheWriter cache;
+  cache.Write<int>(time_units_);
+  cache.Write<uint64_t>(time_range_.first);
+  cache.Write<uint64_t>(time_range_.second);
+  cache.WriteVector(width_by_id_);
+  cache.Write<uint64_t>(signal_id_by_code_.size());
+  for (const auto &[code, id] : signal_id_by_code_) {
+    cache.WriteString(code);
+    cache.Write<uint32_t>(id);
+  }
+  cache.Write<uint64_t>(Roots().size());
+  for (const auto &root : Roots()) {
+    WriteCachedScope(root, &cache);
+  }
+  cache.Write<uint64_t>(chunk_index_.size());
+  for (const auto &chunk : chunk_index_) {
+    cache.Write<uint64_t>(chunk.begin);
+    cache.Write<uint64_t>(chunk.end);
+    cache.Write<uint64_t>(chunk.start_time);
+    cache.WriteVector(chunk.present);
+  }
+  cache.Save(file_name_, kCacheVersion);
+}
+
 void VcdWaveData::Parse() {
   // Start reading declaration commands until all declarations are done.
   while (true) {
@@ -49,21 +241,101 @@ void VcdWaveData::Parse() {
       throw std::runtime_error("VCD parsing error in declarations");
     }
   }
-  // Clear the stack. In practice this should already be empty since properly
-  // formatted files should have upscope commands to do this. However, it isn't
+  // In practice all scopes should be closed at this point since properly
+  // formatted files should have upscope commands for them. However, it isn't
   // really a problem if the last ones are missing.
-  while (!scope_stack_.empty())
-    scope_stack_.pop();
-  // Traverse the completed scope/signal list, and assign parents.
-  BuildParents();
-  ParseSimCommands();
+  scope_depth_ = 0;
+  FinishHierarchy();
+  StartIndexing();
 }
 
-void VcdWaveData::LoadSignalSamples(const std::vector<const Signal *> &signals,
-                                    uint64_t start_time,
-                                    uint64_t end_time) const {
-  // Do nothing, all waves are parsed in upon file load.
-  // TODO: Lazy / on-demand loading might be useful.
+uint64_t VcdWaveData::ReadSignalSamples(
+    const std::vector<const Signal *> &signals, uint64_t start_time,
+    uint64_t end_time, WaveMap *waves) const {
+  // The index may still be growing, only what is there so far can be used.
+  int num_chunks;
+  uint64_t indexed_end_time;
+  bool indexing;
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    num_chunks = num_indexed_;
+    indexed_end_time = indexed_end_time_;
+    indexing = indexing_;
+  }
+  if (indexing && (num_chunks == 0 || start_time > indexed_end_time)) {
+    return indexed_end_time;
+  }
+  if (num_chunks == 0) return std::numeric_limits<uint64_t>::max();
+  // Chunks that overlap the requested time range.
+  const auto chunks_end = chunk_index_.begin() + num_chunks;
+  auto chunk_at = [&](uint64_t time) -> int {
+    const auto it = std::upper_bound(
+        chunk_index_.begin(), chunks_end, time,
+        [](uint64_t t, const ChunkIndex &c) { return t < c.start_time; });
+    return std::max<int>(0, it - chunk_index_.begin() - 1);
+  };
+  const int first_chunk = chunk_at(start_time);
+  const int last_chunk = chunk_at(end_time);
+  // Which IDs to load from each chunk. All of them from the overlapping chunks,
+  // and the value at the start of the range needs the last chunk before those
+  // in which the signal changes.
+  std::vector<uint64_t> load_ids(IdBitmapSize(), 0);
+  std::vector<std::vector<uint64_t>> chunk_load_ids(num_chunks);
+  for (const auto &s : signals) {
+    const uint32_t id = s->id;
+    const uint64_t bit = 1ull << (id % 64);
+    if (load_ids[id / 64] & bit) continue;
+    load_ids[id / 64] |= bit;
+    (*waves)[id] = SampleStore(s->width);
+    for (int i = first_chunk - 1; i >= 0; --i) {
+      if (chunk_index_[i].present[id / 64] & bit) {
+        if (chunk_load_ids[i].empty()) {
+          chunk_load_ids[i].resize(IdBitmapSize(), 0);
+        }
+        chunk_load_ids[i][id / 64] |= bit;
+        break;
+      }
+    }
+  }
+  std::vector<int> chunks_to_parse;
+  for (int i = 0; i < num_chunks; ++i) {
+    if (i >= first_chunk && i <= last_chunk) {
+      chunk_load_ids[i] = load_ids;
+    }
+    if (!chunk_load_ids[i].empty()) chunks_to_parse.push_back(i);
+  }
+  std::vector<SimChunk> chunks(chunks_to_parse.size());
+  const std::string_view text = file_->Data();
+  ParallelFor(chunks_to_parse.size(), [&](int idx) {
+    const auto &index = chunk_index_[chunks_to_parse[idx]];
+    ParseSimChunk(text.substr(index.begin, index.end - index.begin),
+                  chunk_load_ids[chunks_to_parse[idx]], &chunks[idx]);
+  });
+
+  // Stitch the per-chunk sample runs together, in file order. Each run was
+  // deduplicated in isolation, so only the first sample of each run has to be
+  // checked against the tail of the previous runs: every run has at most one
+  // sample per timestamp, so from the second sample on the result is the same
+  // as if everything was parsed sequentially. See SampleStore::Append().
+  for (auto &chunk : chunks) {
+    for (auto &[id, samples] : chunk.waves) {
+      auto &wave = (*waves)[id];
+      if (wave.empty()) {
+        wave = std::move(samples);
+        continue;
+      }
+      wave.Append(samples, keep_glitches_);
+    }
+    // Release memory as soon as possible.
+    chunk.waves.clear();
+  }
+
+  // Signals don't change in the skipped chunks, so the samples are complete
+  // through the end of the last chunk parsed.
+  if (last_chunk + 1 < num_chunks) {
+    return std::max(end_time, chunk_index_[last_chunk + 1].start_time - 1);
+  }
+  return indexing ? indexed_end_time : std::numeric_limits<uint64_t>::max();
 }
 
 void VcdWaveData::ParseToEofCommand() {
@@ -75,45 +347,41 @@ void VcdWaveData::ParseToEofCommand() {
 
 void VcdWaveData::ParseScope() {
   auto tok = tokenizer_.Token();
-  std::string name = "[unnamed]";
+  std::string_view name = "[unnamed]";
   if (tok != "$end") {
     // Ignore current value of tok, the scope type.
     name = tokenizer_.Token();
-    std::string end = tokenizer_.Token();
+    auto end = tokenizer_.Token();
     if (end != "$end") {
       throw MakeParseError("Expecting $end after parsing scope name");
     }
   }
-  if (scope_stack_.empty()) {
-    // New root level scope.
-    roots_.push_back({});
-    roots_.back().name = name;
-    scope_stack_.push(&roots_.back());
-  } else {
-    scope_stack_.top()->children.push_back({});
-    scope_stack_.push(&scope_stack_.top()->children.back());
-    scope_stack_.top()->name = name;
-  }
+  BeginScope(name);
+  scope_depth_++;
 }
 
 void VcdWaveData::ParseUpScope() {
   auto tok = tokenizer_.Token();
-  if (scope_stack_.empty() || tok != "$end") {
+  if (scope_depth_ == 0 || tok != "$end") {
     throw MakeParseError("Expecting $end after parsing upscope");
     ;
   }
-  scope_stack_.pop();
+  EndScope();
+  scope_depth_--;
 }
 
 void VcdWaveData::ParseVariable() {
   tokenizer_.Token(); // Discard the type;
-  int var_size = std::stoi(tokenizer_.Token());
+  int var_size;
+  if (ParseNumber(tokenizer_.Token(), &var_size) == 0) {
+    throw MakeParseError("Invalid variable size");
+  }
   auto code = tokenizer_.Token();
-  auto name = tokenizer_.Token();
+  std::string name(tokenizer_.Token());
   // After the reference identifier, optional bit select index may be present.
   // Append these. At most 5 more tokens in the case of name [ msb : lsb ],
   // with all spaces between them.
-  std::string tok;
+  std::string_view tok;
   int tokens_read = 0;
   while (true) {
     tok = tokenizer_.Token();
@@ -124,10 +392,12 @@ void VcdWaveData::ParseVariable() {
   if (tok != "$end") {
     throw MakeParseError("Expecting $end after parsing variable name");
   }
-  scope_stack_.top()->signals.push_back({});
-  auto &s = scope_stack_.top()->signals.back();
+  Signal *signal = AddSignal(name);
+  if (signal == nullptr) {
+    throw MakeParseError("Variable declared outside of a scope");
+  }
+  auto &s = *signal;
   s.width = var_size;
-  s.name = name;
   // VCD files don't have this info.
   s.type = Signal::kNet;
   s.direction = Signal::kInternal;
@@ -136,22 +406,24 @@ void VcdWaveData::ParseVariable() {
   auto colon_pos = name.find_last_of(':');
   if (range_pos != std::string::npos && colon_pos != std::string::npos &&
       range_pos < colon_pos) {
-    s.lsb = std::stoi(name.substr(colon_pos + 1));
+    ParseNumber(std::string_view(name).substr(colon_pos + 1), &s.lsb);
     s.has_suffix = true;
   }
-  if (signal_id_by_code_.find(code) == signal_id_by_code_.end()) {
-    signal_id_by_code_[code] = current_id_;
+  const auto id = signal_id_by_code_.find(code);
+  if (id == signal_id_by_code_.end()) {
+    signal_id_by_code_.emplace(code, current_id_);
+    width_by_id_.push_back(var_size);
     s.id = current_id_;
     current_id_++;
   } else {
-    s.id = signal_id_by_code_[code];
+    s.id = id->second;
   }
 }
 
 void VcdWaveData::ParseTimescale() {
   auto tok = tokenizer_.Token();
-  size_t chars_read;
-  int val = std::stoi(tok, &chars_read);
+  int val = 0;
+  const int chars_read = ParseNumber(tok, &val);
   if (val != 1 && val != 10 && val != 100) {
     throw MakeParseError("Invalid timescale value");
   }
@@ -188,83 +460,151 @@ void VcdWaveData::ParseTimescale() {
   }
 }
 
-void VcdWaveData::ParseSimCommands() {
+void VcdWaveData::AddSample(SimChunk *chunk, uint32_t id, uint64_t time,
+                            std::string_view value) const {
+  auto it = chunk->waves.find(id);
+  if (it == chunk->waves.end()) {
+    it = chunk->waves.emplace(id, SampleStore(width_by_id_[id])).first;
+  }
+  it->second.Add(time, value, keep_glitches_);
+}
+
+void VcdWaveData::ParseSimChunk(std::string_view text,
+                                const std::vector<uint64_t> &load_ids,
+                                SimChunk *chunk) const {
+  VcdTokenizer tokenizer(text);
   bool in_dump = false;
+  // Chunks other than the first always start with a time command.
   uint64_t time = 0;
-  bool first_time = true;
-  int prev_percentage = -1;
-  auto add_sample = [&](std::vector<Sample> &samples, const Sample &s) {
-    if (!keep_glitches_ && !samples.empty()) {
-      Sample &prev_sample = samples.back();
-      if (s.value == prev_sample.value) {
-        return; // Ignore duplicates.
-      } else if (time == prev_sample.time) {
-        // Does this new value make the previous one pointless?
-        if (samples.size() > 1 &&
-            samples[samples.size() - 2].value == s.value) {
-          samples.pop_back();
-        } else {
-          // Just update the previous with this new value.
-          prev_sample.value = s.value;
-        }
-        return;
-      }
+  chunk->present.assign(IdBitmapSize(), 0);
+  auto value_change = [&](uint32_t id, std::string_view value) {
+    chunk->present[id / 64] |= 1ull << (id % 64);
+    if (id / 64 < load_ids.size() && (load_ids[id / 64] >> (id % 64)) & 1) {
+      AddSample(chunk, id, time, value);
     }
-    samples.push_back(s);
   };
-  while (!tokenizer_.Eof()) {
-    auto tok = tokenizer_.Token();
+  while (!tokenizer.Eof()) {
+    auto tok = tokenizer.Token();
     if (tok.empty()) continue;
     if (!in_dump && absl::StartsWith(tok, "$dump")) {
       in_dump = true;
     } else if (in_dump && tok == "$end") {
       in_dump = false;
     } else if (tok == "$comment") {
-      ParseToEofCommand();
+      while (!tokenizer.Eof() && tokenizer.Token() != "$end") {
+      }
     } else if (tok[0] == '#') {
-      time = std::stol(tok.substr(1));
-      if (first_time) {
-        first_time = false;
-        time_range_.first = time;
+      if (ParseNumber(tok.substr(1), &time) == 0) {
+        throw MakeParseError("Invalid time value");
       }
-    } else if (tok.find_first_of("bBrR") == 0) {
-      Sample s;
-      s.time = time;
-      s.value = tok.substr(1);
-      tok = tokenizer_.Token();
-      if (signal_id_by_code_.find(tok) == signal_id_by_code_.end()) {
+      if (!chunk->first_time) chunk->first_time = time;
+      chunk->last_time = time;
+    } else if (tok[0] == 'b' || tok[0] == 'B' || tok[0] == 'r' ||
+               tok[0] == 'R') {
+      const auto id = signal_id_by_code_.find(tokenizer.Token());
+      if (id == signal_id_by_code_.end()) {
         throw MakeParseError(
             "multi-bit signal value references unknown signal");
       }
-      add_sample(waves_[signal_id_by_code_[tok]], s);
-    } else if (tok.find_first_of("01xXzZ") == 0) {
-      Sample s;
-      s.time = time;
-      s.value = tok[0];
+      value_change(id->second, tok.substr(1));
+    } else if (tok[0] == '0' || tok[0] == '1' || tok[0] == 'x' ||
+               tok[0] == 'X' || tok[0] == 'z' || tok[0] == 'Z') {
       const auto id_code = tok.substr(1);
       const auto id = signal_id_by_code_.find(id_code);
       if (id == signal_id_by_code_.end()) {
         throw MakeParseError(
             "single-bit signal value references unknown signal");
       }
-      add_sample(waves_[id->second], s);
+      value_change(id->second, tok.substr(0, 1));
     } else {
       throw MakeParseError("Unknown simulation command.");
     }
-    if (print_progress_) {
-      int percentage = tokenizer_.PosPercentage();
-      if (percentage != prev_percentage) {
-        printf("%d%%\r", percentage);
-        fflush(stdout);
-        prev_percentage = percentage;
+  }
+}
+
+void VcdWaveData::StartIndexing() {
+  // Split the remaining text into chunks that start at a time command, so that
+  // they can be scanned independently on all available cores. No samples are
+  // kept at this point, only the index of which signals change in each chunk.
+  const std::string_view text = file_->Data();
+  const uint64_t start_pos = tokenizer_.Position();
+  const int num_threads = std::max(1u, std::thread::hardware_concurrency());
+  const uint64_t chunk_size =
+      std::clamp((text.size() - start_pos) / (4 * num_threads),
+                 kMinChunkSize, kMaxChunkSize);
+  chunk_index_.clear();
+  for (uint64_t begin = start_pos; begin < text.size();) {
+    const uint64_t end = NextTimeLine(text, begin + chunk_size);
+    chunk_index_.push_back(
+        {.begin = begin, .end = end, .start_time = 0, .present = {}});
+    begin = end;
+  }
+  {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    num_indexed_ = 0;
+    indexed_end_time_ = 0;
+    time_range_ = {0, 1};
+    indexing_ = true;
+  }
+  stop_indexing_ = false;
+  index_thread_ = std::thread([this] { IndexSimCommands(); });
+}
+
+void VcdWaveData::IndexSimCommands() {
+  const std::string_view text = file_->Data();
+  const int num_chunks = chunk_index_.size();
+  // Chunks are scanned a batch at a time, and made available after each.
+  const int batch_size = std::max(1u, std::thread::hardware_concurrency());
+  bool first_time = true;
+  uint64_t time = 0;
+  uint64_t range_start = 0;
+  try {
+    for (int batch = 0; batch < num_chunks && !stop_indexing_;
+         batch += batch_size) {
+      std::vector<SimChunk> chunks(std::min(batch_size, num_chunks - batch));
+      ParallelFor(chunks.size(), [&](int idx) {
+        const auto &index = chunk_index_[batch + idx];
+        ParseSimChunk(text.substr(index.begin, index.end - index.begin), {},
+                      &chunks[idx]);
+      });
+      for (int idx = 0; idx < chunks.size(); ++idx) {
+        const int i = batch + idx;
+        auto &chunk = chunks[idx];
+        if (chunk.first_time) {
+          if (first_time) {
+            first_time = false;
+            range_start = *chunk.first_time;
+          }
+          time = chunk.last_time;
+        }
+        // The first chunk may have value changes before any time command.
+        if (i > 0) {
+          chunk_index_[i].start_time =
+              chunk.first_time.value_or(chunk_index_[i - 1].start_time);
+        }
+        chunk_index_[i].present = std::move(chunk.present);
       }
+      std::lock_guard<std::mutex> lock(index_mutex_);
+      num_indexed_ = batch + chunks.size();
+      indexed_end_time_ = time;
+      // Avoid start > end.
+      time_range_ = {range_start, std::max(range_start + 1, time)};
     }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(index_mutex_);
+    index_error_ = std::current_exception();
+    indexing_ = false;
+    return;
   }
-  // Avoid start > end.
-  time_range_.second = std::max(time_range_.first + 1, time);
-  if (print_progress_) {
-    printf("\n");
-  }
+  // Only a complete index is worth saving.
+  if (use_cache_ && !stop_indexing_) WriteCache();
+  std::lock_guard<std::mutex> lock(index_mutex_);
+  indexing_ = false;
+}
+
+void VcdWaveData::StopIndexing() {
+  stop_indexing_ = true;
+  if (index_thread_.joinable()) index_thread_.join();
 }
 
 } // namespace sv
@@ -1,45 +1,112 @@
 #pragma once
 
 #include "absl/container/flat_hash_map.h"
+#include "mapped_file.h"
 #include "vcd_tokenizer.h"
+#include "wave_cache.h"
 #include "wave_data.h"
-#include <stack>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
 
 namespace sv {
 
 // VCD implementation of the WaveData interface. Full blown parser.
+//
+// Only the header is parsed up front. The value change section is indexed on
+// a background thread, front to back, and what is indexed can be used right
+// away: the TimeRange() grows as the indexing progresses.
 class VcdWaveData : public WaveData {
  public:
-  static void PrintLoadProgress(bool b) { print_progress_ = b; }
+  // Enables saving and reusing parsed data across runs. See wave_cache.h.
+  static void UseCache(bool b) { use_cache_ = b; }
   VcdWaveData(const std::string &file_name, bool keep_glitches);
+  ~VcdWaveData() override;
   int Log10TimeUnits() const final { return time_units_; }
-  std::pair<uint64_t, uint64_t> TimeRange() const final { return time_range_; }
-  void LoadSignalSamples(const std::vector<const Signal *> &signals,
-                         uint64_t start_time, uint64_t end_time) const final;
+  std::pair<uint64_t, uint64_t> TimeRange() const final;
+  bool Loading() const final;
+  uint64_t ReadSignalSamples(const std::vector<const Signal *> &signals,
+                             uint64_t start_time, uint64_t end_time,
+                             WaveMap *waves) const final;
   void Reload() final;
 
  private:
   // Parse and discard tokens until and $end is encountered.
   void Parse();
+  // Load the signals and value change index from the cache, or parse the file
+  // and save them to the cache.
+  void ParseOrReadCache();
+  bool ReadCache();
+  void ReadCachedScope(WaveCacheReader *cache);
+  void WriteCache() const;
   void ParseToEofCommand();
   void ParseVariable();
   void ParseScope();
   void ParseUpScope();
   void ParseTimescale();
-  void ParseSimCommands();
+  // Splits the value change section into chunks, and starts indexing them.
+  void StartIndexing();
+  // Body of the indexing thread.
+  void IndexSimCommands();
+  void StopIndexing();
+  // Value changes from a section of the file that starts at a time command
+  // (or the end of the header). Chunks are parsed in parallel and then
+  // stitched together.
+  struct SimChunk {
+    absl::flat_hash_map<uint32_t, SampleStore> waves;
+    // Bitmap of the IDs that have value changes in the chunk.
+    std::vector<uint64_t> present;
+    std::optional<uint64_t> first_time;
+    uint64_t last_time = 0;
+  };
+  // Only samples for IDs in the load_ids bitmap are kept.
+  void ParseSimChunk(std::string_view text,
+                     const std::vector<uint64_t> &load_ids,
+                     SimChunk *chunk) const;
+  void AddSample(SimChunk *chunk, uint32_t id, uint64_t time,
+                 std::string_view value) const;
+  int IdBitmapSize() const { return (current_id_ + 63) / 64; }
 
   // Identifier codes vs IDs
   absl::flat_hash_map<std::string, uint32_t> signal_id_by_code_;
+  // Signal width for each ID.
+  std::vector<int> width_by_id_;
   std::pair<uint64_t, uint64_t> time_range_ = {0, 0};
   int time_units_;
+  // The whole file is mapped, and tokens are views into it.
+  std::unique_ptr<MappedFile> file_;
   VcdTokenizer tokenizer_;
+  // Index of the value change section, built when the file is opened. Samples
+  // are only loaded on demand, from the chunks that overlap the requested time
+  // range and in which the requested signals actually change.
+  struct ChunkIndex {
+    uint64_t begin;
+    uint64_t end;
+    // Value changes in the chunk are at or after this time.
+    uint64_t start_time;
+    // Bitmap of the IDs that have value changes in the chunk.
+    std::vector<uint64_t> present;
+  };
+  std::vector<ChunkIndex> chunk_index_;
+  // Indexing state, guarded by the mutex. Only the first num_indexed_ entries
+  // of chunk_index_ are filled in, the rest is left alone while the index
+  // grows. The samples are complete through indexed_end_time_.
+  mutable std::mutex index_mutex_;
+  int num_indexed_ = 0;
+  uint64_t indexed_end_time_ = 0;
+  bool indexing_ = false;
+  mutable std::exception_ptr index_error_;
+  std::atomic<bool> stop_indexing_ = false;
+  std::thread index_thread_;
 
   // State while parsing header. Not used otherwise.
-  std::stack<SignalScope *> scope_stack_;
+  int scope_depth_ = 0;
   uint32_t current_id_ = 0;
 
-  // Progress printf on the console.
-  static bool print_progress_;
+  static bool use_cache_;
 };
 
 } // namespace sv
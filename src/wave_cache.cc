@@ -0,0 +1,103 @@
+#include "wave_cache.h"
+#include "absl/strings/str_format.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <sys/stat.h>
+
+namespace sv {
+namespace {
+
+constexpr std::string_view kMagic = "simview wave cache\n";
+
+// Identifies a specific version of a wave file.
+struct WaveFileKey {
+  std::string path;
+  uint64_t size;
+  int64_t mtime_sec;
+  int64_t mtime_nsec;
+};
+
+std::optional<WaveFileKey> KeyForFile(const std::string &wave_file_name) {
+  struct stat st;
+  if (stat(wave_file_name.c_str(), &st) != 0) return std::nullopt;
+  std::error_code ec;
+  const auto path = std::filesystem::absolute(wave_file_name, ec);
+  if (ec) return std::nullopt;
+  return WaveFileKey{.path = path.lexically_normal().string(),
+                     .size = static_cast<uint64_t>(st.st_size),
+                     .mtime_sec = st.st_mtim.tv_sec,
+                     .mtime_nsec = st.st_mtim.tv_nsec};
+}
+
+} // namespace
+
+std::string WaveCachePath(const std::string &wave_file_name) {
+  std::error_code ec;
+  const std::filesystem::path path =
+      std::filesystem::absolute(wave_file_name, ec).lexically_normal();
+  const char *xdg_cache_home = std::getenv("XDG_CACHE_HOME");
+  if (xdg_cache_home != nullptr && xdg_cache_home[0] != '\0') {
+    // Flatten the full path into a unique file name.
+    return absl::StrFormat(
+        "%s/simview/%s.%016x", xdg_cache_home, path.filename().string(),
+        std::hash<std::string>()(path.parent_path().string()));
+  }
+  return (path.parent_path() / ("." + path.filename().string() + ".simview"))
+      .string();
+}
+
+void WaveCacheWriter::Save(const std::string &wave_file_name,
+                           uint32_t version) const {
+  const auto key = KeyForFile(wave_file_name);
+  if (!key) return;
+  WaveCacheWriter header;
+  header.buffer_ = kMagic;
+  header.Write(version);
+  header.WriteString(key->path);
+  header.Write(key->size);
+  header.Write(key->mtime_sec);
+  header.Write(key->mtime_nsec);
+  // Write to a temporary file first, so that a partially written cache is
+  // never picked up.
+  const std::filesystem::path cache_path = WaveCachePath(wave_file_name);
+  std::error_code ec;
+  std::filesystem::create_directories(cache_path.parent_path(), ec);
+  const std::string tmp_path = cache_path.string() + ".tmp";
+  FILE *f = fopen(tmp_path.c_str(), "wb");
+  if (f == nullptr) return;
+  const bool ok =
+      fwrite(header.buffer_.data(), 1, header.buffer_.size(), f) ==
+          header.buffer_.size() &&
+      fwrite(buffer_.data(), 1, buffer_.size(), f) == buffer_.size();
+  if (fclose(f) != 0 || !ok) {
+    std::filesystem::remove(tmp_path, ec);
+    return;
+  }
+  std::filesystem::rename(tmp_path, cache_path, ec);
+  if (ec) std::filesystem::remove(tmp_path, ec);
+}
+
+bool WaveCacheReader::Open(const std::string &wave_file_name,
+                           uint32_t version) {
+  const auto key = KeyForFile(wave_file_name);
+  if (!key) return false;
+  try {
+    file_ = std::make_unique<MappedFile>(WaveCachePath(wave_file_name));
+    data_ = file_->Data();
+    pos_ = 0;
+    if (std::string_view(Advance(kMagic.size()), kMagic.size()) != kMagic) {
+      return false;
+    }
+    return Read<uint32_t>() == version && ReadString() == key->path &&
+           Read<uint64_t>() == key->size &&
+           Read<int64_t>() == key->mtime_sec &&
+           Read<int64_t>() == key->mtime_nsec;
+  } catch (const std::runtime_error &e) {
+    return false;
+  }
+}
+
+} // namespace sv
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "mapped_file.h"
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace sv {
+
+// Wave files can take minutes to parse, so the results are saved to a cache
+// file and reused the next time the same file is opened. The cache lives in
+// $XDG_CACHE_HOME/simview if that is set, otherwise next to the wave file. It
+// is keyed by the wave file's path, size and modification time, and a format
+// version that must be bumped whenever the cached data layout changes.
+//
+// The same goes for Surelog's design database, which is only reused if the
+// cache saved for it shows that it was built from the current inputs.
+std::string WaveCachePath(const std::string &wave_file_name);
+
+// Builds up the cache contents in memory and saves them in one go.
+class WaveCacheWriter {
+ public:
+  template <typename T>
+  void Write(T v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    buffer_.append(reinterpret_cast<const char *>(&v), sizeof(v));
+  }
+  void WriteString(std::string_view s) {
+    Write<uint64_t>(s.size());
+    buffer_.append(s);
+  }
+  template <typename T>
+  void WriteVector(const std::vector<T> &v) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    Write<uint64_t>(v.size());
+    buffer_.append(reinterpret_cast<const char *>(v.data()),
+                   v.size() * sizeof(T));
+  }
+  // Failures are silently ignored, since the cache is only an optimization.
+  void Save(const std::string &wave_file_name, uint32_t version) const;
+
+ private:
+  std::string buffer_;
+};
+
+// Reads back what the WaveCacheWriter saved, in the same order.
+class WaveCacheReader {
+ public:
+  // Returns false if there is no usable cache for the wave file.
+  bool Open(const std::string &wave_file_name, uint32_t version);
+  // These throw std::runtime_error if reading past the end of the cache.
+  template <typename T>
+  T Read() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    T v;
+    memcpy(&v, Advance(sizeof(T)), sizeof(T));
+    return v;
+  }
+  std::string_view ReadString() {
+    const uint64_t size = Read<uint64_t>();
+    return std::string_view(Advance(size), size);
+  }
+  template <typename T>
+  std::vector<T> ReadVector() {
+    static_assert(std::is_trivially_copyable_v<T>);
+    const uint64_t size = Read<uint64_t>();
+    if (size > (data_.size() - pos_) / sizeof(T)) {
+      throw std::runtime_error("Truncated wave cache");
+    }
+    std::vector<T> v(size);
+    if (size > 0) memcpy(v.data(), Advance(size * sizeof(T)), size * sizeof(T));
+    return v;
+  }
+  bool AtEnd() const { return pos_ == data_.size(); }
+
+ private:
+  const char *Advance(uint64_t size) {
+    if (size > data_.size() - pos_) {
+      throw std::runtime_error("Truncated wave cache");
+    }
+    pos_ += size;
+    return data_.data() + pos_ - size;
+  }
+
+  std::unique_ptr<MappedFile> file_;
+  std::string_view data_;
+  uint64_t pos_ = 0;
+};
+
+} // namespace sv
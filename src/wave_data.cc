@@ -1,8 +1,10 @@
 #include "wave_data.h"
-#include "absl/strings/str_cat.h"
-#include "absl/strings/str_split.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
 #include "fst_wave_data.h"
 #include "vcd_wave_data.h"
+#include <algorithm>
 #include <filesystem>
 #include <uhdm/module_inst.h>
 #include <uhdm/net.h>
@@ -15,6 +17,42 @@
 
 namespace sv {
 
+namespace {
+
+// FNV-1a, which can be continued piece by piece. This way the path hashes of
+// all signals follow from those of their scopes.
+constexpr uint64_t kPathHashSeed = 14695981039346656037ull;
+
+uint64_t ExtendPathHash(uint64_t hash, std::string_view s) {
+  for (const char c : s) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+// Whether the path is exactly that of the signal, going up the hierarchy from
+// the end of the path.
+bool PathMatches(const WaveData::Signal *signal, std::string_view path) {
+  const auto remove_suffix = [&](std::string_view name) {
+    if (path.size() < name.size() ||
+        path.substr(path.size() - name.size()) != name) {
+      return false;
+    }
+    path.remove_suffix(name.size());
+    return true;
+  };
+  if (!remove_suffix(signal->name)) return false;
+  for (auto *scope = signal->scope; scope != nullptr; scope = scope->parent) {
+    if (!remove_suffix(".") || !remove_suffix(scope->name)) return false;
+  }
+  return path.empty();
+}
+
+} // namespace
+
+uint64_t WaveData::memory_limit_ = 0;
+
 std::unique_ptr<WaveData> WaveData::ReadWaveFile(const std::string &file_name,
                                                  bool keep_glitches) {
   std::string ext = std::filesystem::path(file_name).extension().string();
@@ -29,42 +67,63 @@ std::unique_ptr<WaveData> WaveData::ReadWaveFile(const std::string &file_name,
 }
 
 std::optional<const WaveData::Signal *>
-WaveData::PathToSignal(const std::string &path) const {
-  std::vector<std::string> levels = absl::StrSplit(path, '.');
-  const std::vector<SignalScope> *candidates = &roots_;
-  const SignalScope *candidate = nullptr;
-  int level_idx = 0;
-  for (auto &level : levels) {
-    // Match against the signals for the last element.
-    if (level_idx == levels.size() - 1) {
-      if (candidate == nullptr) break;
-      for (const auto &signal : candidate->signals) {
-        if (signal.name == level) return &signal;
-      }
-    } else {
-      level_idx++;
-      for (const auto &scope : *candidates) {
-        if (scope.name == level) {
-          candidates = &scope.children;
-          candidate = &scope;
-          continue;
-        }
-      }
-      // No matching level, so abort.
-      if (candidate == nullptr) break;
+WaveData::PathToSignal(std::string_view path) const {
+  auto it = signals_by_path_.find(path);
+  if (it == signals_by_path_.end()) return std::nullopt;
+  return it->signal;
+}
+
+size_t WaveData::PathHash::operator()(std::string_view path) const {
+  return ExtendPathHash(kPathHashSeed, path);
+}
+
+bool WaveData::PathEq::operator()(const PathEntry &a,
+                                  const PathEntry &b) const {
+  if (a.hash != b.hash || a.signal->name != b.signal->name) return false;
+  const SignalScope *scope_a = a.signal->scope;
+  const SignalScope *scope_b = b.signal->scope;
+  while (scope_a != scope_b) {
+    if (scope_a == nullptr || scope_b == nullptr ||
+        scope_a->name != scope_b->name) {
+      return false;
     }
+    scope_a = scope_a->parent;
+    scope_b = scope_b->parent;
   }
-  return std::nullopt;
+  return true;
+}
+
+bool WaveData::PathEq::operator()(const PathEntry &entry,
+                                  std::string_view path) const {
+  return PathMatches(entry.signal, path);
 }
 
 std::string WaveData::SignalToPath(const WaveData::Signal *signal) {
-  std::string path = signal->name;
-  auto scope = signal->scope;
-  while (scope != nullptr) {
-    path = absl::StrCat(scope->name, ".", path);
-    scope = scope->parent;
+  std::vector<std::string_view> names = {signal->name};
+  for (auto *scope = signal->scope; scope != nullptr; scope = scope->parent) {
+    names.push_back(scope->name);
+  }
+  std::reverse(names.begin(), names.end());
+  return absl::StrJoin(names, ".");
+}
+
+void WaveData::LoadSignalSamples(const std::vector<const Signal *> &signals,
+                                 uint64_t start_time, uint64_t end_time) const {
+  std::vector<const Signal *> to_read;
+  absl::flat_hash_set<uint32_t> ids;
+  for (const auto *s : signals) {
+    if (s == nullptr) continue;
+    // Don't re-read existing waves.
+    if (SamplesValid(s, start_time, end_time)) continue;
+    // Aliases share the wave, read it once.
+    if (ids.insert(s->id).second) to_read.push_back(s);
   }
-  return path;
+  if (to_read.empty()) return;
+  WaveMap waves;
+  const uint64_t valid_end_time =
+      ReadSignalSamples(to_read, start_time, end_time, &waves);
+  ApplySignalSamples(signals, start_time, valid_end_time, &waves,
+                     /*append*/ false);
 }
 
 void WaveData::LoadSignalSamples(const Signal *signal, uint64_t start_time,
@@ -74,42 +133,254 @@ void WaveData::LoadSignalSamples(const Signal *signal, uint64_t start_time,
   LoadSignalSamples(sigs, start_time, end_time);
 }
 
-void WaveData::BuildParents() {
-  std::function<void(SignalScope *)> recurse_assign_parents =
-      [&](SignalScope *scope) {
-        // Assign to all signals.
-        for (auto &sig : scope->signals) {
-          sig.scope = scope;
-        }
-        for (auto &sub : scope->children) {
-          sub.parent = scope;
-          recurse_assign_parents(&sub);
-        }
-      };
-  for (auto &root : roots_) {
-    recurse_assign_parents(&root);
+std::vector<const WaveData::Signal *>
+WaveData::ApplySignalSamples(const std::vector<const Signal *> &signals,
+                             uint64_t start_time, uint64_t valid_end_time,
+                             WaveMap *waves, bool append) const {
+  std::vector<const Signal *> dropped;
+  for (const auto *s : signals) {
+    if (s == nullptr) continue;
+    auto it = waves->find(s->id);
+    if (it == waves->end()) continue;
+    auto &samples = it->second;
+    auto &wave = waves_[s->id];
+    // Update the valid range based on sample data actually received.
+    uint64_t end_time = valid_end_time;
+    if (!samples.empty()) {
+      end_time = std::max(end_time, samples.Time(samples.size() - 1));
+    }
+    if (wave.valid_start_time <= start_time && wave.valid_end_time >= end_time) {
+      continue;
+    }
+    if (!append) {
+      wave.samples = std::move(samples);
+      wave.valid_start_time = wave.samples.empty()
+                                  ? start_time
+                                  : std::min(start_time, wave.samples.Time(0));
+    } else if (wave.valid_start_time <= start_time &&
+               wave.valid_end_time + 1 >= start_time) {
+      // The tail of the previous read can overlap.
+      wave.samples.Extend(std::move(samples), wave.valid_end_time,
+                          keep_glitches_);
+    } else {
+      // The wave changed since the previous part was applied.
+      dropped.push_back(s);
+      continue;
+    }
+    wave.valid_end_time = end_time;
+    wave.last_use = ++use_count_;
+    // Aliases share the wave, they are done too.
+    waves->erase(it);
   }
+  EvictWaves();
+  return dropped;
+}
+
+void WaveData::EvictWaves() const {
+  if (memory_limit_ == 0) return;
+  uint64_t memory = 0;
+  // Last use and ID of the waves that may go.
+  std::vector<std::pair<uint64_t, uint32_t>> candidates;
+  for (const auto &[id, wave] : waves_) {
+    memory += wave.samples.MemoryUsage();
+    if (wave.last_use < in_use_since_) candidates.push_back({wave.last_use, id});
+  }
+  std::sort(candidates.begin(), candidates.end());
+  for (const auto &[last_use, id] : candidates) {
+    if (memory <= memory_limit_) break;
+    auto it = waves_.find(id);
+    memory -= it->second.samples.MemoryUsage();
+    waves_.erase(it);
+  }
+}
+
+void WaveData::BeginScope(std::string_view name) {
+  new_scopes_.push_back(
+      {names_.Intern(name), open_scopes_.empty() ? -1 : open_scopes_.back()});
+  open_scopes_.push_back(new_scopes_.size() - 1);
+}
+
+void WaveData::EndScope() {
+  if (!open_scopes_.empty()) open_scopes_.pop_back();
+}
+
+WaveData::Signal *WaveData::AddSignal(std::string_view name) {
+  if (open_scopes_.empty()) return nullptr;
+  signals_.push_back({});
+  signals_.back().name = names_.Intern(name);
+  new_signal_scopes_.push_back(open_scopes_.back());
+  return &signals_.back();
+}
+
+void WaveData::FinishHierarchy() {
+  const int num_scopes = new_scopes_.size();
+  // Group the children of each scope, keeping them in file order. Those of
+  // scope i end up at [child_offsets[i + 1], child_offsets[i + 2]) in
+  // children, after the roots.
+  std::vector<int> child_offsets(num_scopes + 2, 0);
+  for (const auto &scope : new_scopes_) {
+    child_offsets[scope.parent + 2]++;
+  }
+  for (int i = 1; i < child_offsets.size(); ++i) {
+    child_offsets[i] += child_offsets[i - 1];
+  }
+  std::vector<int> children(num_scopes);
+  std::vector<int> next_child(child_offsets);
+  for (int i = 0; i < num_scopes; ++i) {
+    children[next_child[new_scopes_[i].parent + 1]++] = i;
+  }
+  // Lay out the scopes breadth first, so that siblings are contiguous.
+  num_roots_ = child_offsets[1];
+  std::vector<int> order(children.begin(), children.begin() + num_roots_);
+  std::vector<int> position(num_scopes);
+  std::vector<int> first_child(num_scopes);
+  order.reserve(num_scopes);
+  for (int pos = 0; pos < order.size(); ++pos) {
+    const int i = order[pos];
+    position[i] = pos;
+    first_child[pos] = order.size();
+    order.insert(order.end(), children.begin() + child_offsets[i + 1],
+                 children.begin() + child_offsets[i + 2]);
+  }
+  // Same for the signals of each scope.
+  std::vector<int> signal_offsets(num_scopes + 1, 0);
+  for (const int scope : new_signal_scopes_) {
+    signal_offsets[position[scope] + 1]++;
+  }
+  for (int i = 1; i < signal_offsets.size(); ++i) {
+    signal_offsets[i] += signal_offsets[i - 1];
+  }
+  std::vector<Signal> signals(signals_.size());
+  std::vector<int> next_signal(signal_offsets);
+  for (int i = 0; i < signals_.size(); ++i) {
+    signals[next_signal[position[new_signal_scopes_[i]]]++] =
+        std::move(signals_[i]);
+  }
+  signals_ = std::move(signals);
+  scopes_.resize(num_scopes);
+  for (int pos = 0; pos < num_scopes; ++pos) {
+    const int i = order[pos];
+    auto &scope = scopes_[pos];
+    scope.name = new_scopes_[i].name;
+    const int parent = new_scopes_[i].parent;
+    scope.parent = parent < 0 ? nullptr : &scopes_[position[parent]];
+    scope.children =
+        absl::MakeConstSpan(scopes_.data() + first_child[pos],
+                            child_offsets[i + 2] - child_offsets[i + 1]);
+    scope.signals = absl::MakeConstSpan(
+        signals_.data() + signal_offsets[pos],
+        signal_offsets[pos + 1] - signal_offsets[pos]);
+    for (int s = signal_offsets[pos]; s < signal_offsets[pos + 1]; ++s) {
+      signals_[s].scope = &scope;
+    }
+  }
+  // Parents are laid out before their children, so the path hashes of the
+  // scopes can be built up in one go.
+  std::vector<uint64_t> scope_hashes(num_scopes);
+  signals_by_path_.reserve(signals_.size());
+  for (int pos = 0; pos < num_scopes; ++pos) {
+    const auto &scope = scopes_[pos];
+    uint64_t hash = kPathHashSeed;
+    if (scope.parent != nullptr) {
+      hash = ExtendPathHash(scope_hashes[scope.parent - scopes_.data()], ".");
+    }
+    scope_hashes[pos] = ExtendPathHash(hash, scope.name);
+    const uint64_t prefix_hash = ExtendPathHash(scope_hashes[pos], ".");
+    for (const auto &signal : scope.signals) {
+      // The first of any signals with the same path wins.
+      signals_by_path_.insert(
+          {ExtendPathHash(prefix_hash, signal.name), &signal});
+    }
+  }
+  new_scopes_.clear();
+  new_scopes_.shrink_to_fit();
+  new_signal_scopes_.clear();
+  new_signal_scopes_.shrink_to_fit();
+  open_scopes_.clear();
+}
+
+void WaveData::ClearHierarchy() {
+  scopes_.clear();
+  num_roots_ = 0;
+  signals_.clear();
+  names_.Clear();
+  signals_by_path_.clear();
+  new_scopes_.clear();
+  new_signal_scopes_.clear();
+  open_scopes_.clear();
+}
+
+bool WaveData::SamplesValid(const Signal *s, uint64_t start_time,
+                            uint64_t end_time) const {
+  const auto it = waves_.find(s->id);
+  return it != waves_.end() && it->second.valid_start_time <= start_time &&
+         it->second.valid_end_time >= end_time;
+}
+
+std::optional<uint64_t> WaveData::ValidEndTime(const Signal *s,
+                                               uint64_t time) const {
+  const auto it = waves_.find(s->id);
+  if (it == waves_.end() || it->second.valid_start_time > time ||
+      it->second.valid_end_time < time) {
+    return std::nullopt;
+  }
+  return it->second.valid_end_time;
 }
 
 int WaveData::FindSampleIndex(uint64_t time, const Signal *signal, int left,
                               int right) const {
-  auto &wave = waves_[signal->id];
-  // Binary search for the right sample.
+  auto &wave = waves_[signal->id].samples;
   if (wave.empty() || right < left) return -1;
-  if (right - left <= 1) {
-    // Use the new value when on the same time.
-    return time < wave[right].time ? left : right;
+  return std::min(right, wave.FindIndex(time, left));
+}
+
+int WaveData::FindSampleIndex(uint64_t time, const Signal *signal) const {
+  return waves_[signal->id].samples.FindIndex(time);
+}
+
+std::string WaveData::FindSampleValue(uint64_t time,
+                                      const Signal *signal) const {
+  const int idx = FindSampleIndex(time, signal);
+  if (idx < 0) return "";
+  return waves_[signal->id].samples.Value(idx);
+}
+
+std::vector<std::string> WaveData::SignalValuesAt(
+    const std::vector<const Signal *> &signals, uint64_t time) const {
+  std::vector<std::string> values(signals.size());
+  std::vector<const Signal *> unloaded;
+  std::vector<int> unloaded_idx;
+  for (int i = 0; i < signals.size(); ++i) {
+    if (SamplesValid(signals[i], time, time)) {
+      values[i] = FindSampleValue(time, signals[i]);
+    } else {
+      unloaded.push_back(signals[i]);
+      unloaded_idx.push_back(i);
+    }
   }
-  const int mid = (left + right) / 2;
-  if (time > wave[mid].time) {
-    return FindSampleIndex(time, signal, mid, right);
-  } else {
-    return FindSampleIndex(time, signal, left, mid);
+  if (unloaded.empty()) return values;
+  std::vector<std::string> read_values = ReadSignalValues(unloaded, time);
+  for (int i = 0; i < unloaded.size(); ++i) {
+    values[unloaded_idx[i]] = std::move(read_values[i]);
   }
+  return values;
 }
 
-int WaveData::FindSampleIndex(uint64_t time, const Signal *signal) const {
-  return FindSampleIndex(time, signal, 0, waves_[signal->id].size() - 1);
+std::vector<std::string> WaveData::ReadSignalValues(
+    const std::vector<const Signal *> &signals, uint64_t time) const {
+  WaveMap waves;
+  ReadSignalSamples(signals, time, time, &waves);
+  std::vector<std::string> values;
+  values.reserve(signals.size());
+  for (const auto *s : signals) {
+    auto it = waves.find(s->id);
+    if (it == waves.end() || it->second.empty()) {
+      values.emplace_back();
+    } else {
+      values.push_back(it->second.Value(it->second.FindIndex(time)));
+    }
+  }
+  return values;
 }
 
 namespace {
@@ -156,8 +427,6 @@ void ApplyDesignData(const UHDM::any *design_scope,
               const auto *spec = dynamic_cast<const UHDM::struct_typespec *>(
                   n->Typespec()->Actual_typespec());
               ApplyStruct(spec, s, s.width - 1);
-              const_cast<WaveData::Signal &>(s).name +=
-                  absl::StrFormat("members=%d ", spec->Members()->size());
             }
           }
         }
@@ -1,10 +1,16 @@
 #pragma once
 
 #include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
+#include "sample_store.h"
+#include "string_pool.h"
 #include <uhdm/design.h>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace sv {
@@ -15,12 +21,12 @@ class WaveData {
   // Picks the right subclass based on file extension.
   static std::unique_ptr<WaveData> ReadWaveFile(const std::string &file_name,
                                                 bool keep_glitches);
+  // Limits the memory used by loaded samples. Once over the limit, the waves
+  // that were used least recently are dropped, and loaded again when needed.
+  // Zero means no limit.
+  static void SetMemoryLimit(uint64_t bytes) { memory_limit_ = bytes; }
 
   struct SignalScope;
-  struct Sample {
-    uint64_t time;
-    std::string value;
-  };
   struct SignalStructMember {
     std::string_view name;
     std::vector<SignalStructMember> children;  // empty for normal nets.
@@ -42,7 +48,8 @@ class WaveData {
       kParameter,
       kStruct,
     } type = Type::kNet;
-    std::string name;
+    // Interned, see WaveData::BeginScope().
+    std::string_view name;
     int width;
     int lsb = 0;
     // Set if the signal name string already contains the [msb:lsb] suffix.
@@ -54,45 +61,101 @@ class WaveData {
     const SignalScope *scope = nullptr;
     // Modified by design files.
     mutable std::vector<SignalStructMember> struct_members;
-    // This can be loaded / reloaded.
-    mutable uint64_t valid_start_time = 0;
-    mutable uint64_t valid_end_time = 0;
   };
+  // Scopes and signals live in flat arrays owned by the WaveData, so these
+  // are views into those.
   struct SignalScope {
-    std::string name;
-    std::vector<SignalScope> children;
-    std::vector<Signal> signals;
+    std::string_view name;
+    absl::Span<const SignalScope> children;
+    absl::Span<const Signal> signals;
     const SignalScope *parent = nullptr;
   };
-  const std::vector<Sample> &Wave(const Signal *s) const {
-    return waves_[s->id];
+  const SampleStore &Wave(const Signal *s) const {
+    auto &wave = waves_[s->id];
+    wave.last_use = ++use_count_;
+    return wave.samples;
   }
-  const std::vector<SignalScope> &Roots() const { return roots_; }
-  std::optional<const Signal *> PathToSignal(const std::string &path) const;
+  // Whether the Wave() of the signal holds all samples over the time range.
+  bool SamplesValid(const Signal *s, uint64_t start_time,
+                    uint64_t end_time) const;
+  // The time through which the Wave() of the signal holds all samples, if it
+  // does so from the given time on.
+  std::optional<uint64_t> ValidEndTime(const Signal *s, uint64_t time) const;
+  // Waves used from here on are not dropped by the memory limit until the next
+  // call. The UI calls this before each redraw, so that what is on screen
+  // stays loaded.
+  void KeepWavesInUse() const { in_use_since_ = use_count_ + 1; }
+  absl::Span<const SignalScope> Roots() const {
+    return absl::MakeConstSpan(scopes_.data(), num_roots_);
+  }
+  // Looks up a signal by the full path from SignalToPath(). This is a hash
+  // lookup, so it's fine to resolve long lists of saved paths.
+  std::optional<const Signal *> PathToSignal(std::string_view path) const;
   static std::string SignalToPath(const WaveData::Signal *signal);
-  // Loads up the waves_ structure with sample data for the given Signal.
+  // Samples read for a set of signals, by ID.
+  using WaveMap = absl::flat_hash_map<uint32_t, SampleStore>;
+  // Loads up the waves_ structure with sample data for the given signals,
+  // skipping those that already cover the time range.
+  void LoadSignalSamples(const std::vector<const Signal *> &signals,
+                         uint64_t start_time, uint64_t end_time) const;
+  // Variant for a single signal.
   void LoadSignalSamples(const Signal *signal, uint64_t start_time,
                          uint64_t end_time) const;
+  // Second half of LoadSignalSamples(), for samples obtained from
+  // ReadSignalSamples(): makes them the Wave() of the signals. With append set,
+  // they continue the waves instead, which must be valid up to start_time.
+  // Signals that already cover the range are left alone in either case.
+  // Returns the signals whose waves couldn't be continued, because they were
+  // replaced or evicted in the meantime. Those need to be read again from the
+  // start.
+  std::vector<const Signal *>
+  ApplySignalSamples(const std::vector<const Signal *> &signals,
+                     uint64_t start_time, uint64_t valid_end_time,
+                     WaveMap *waves, bool append) const;
   // Returns the sample index corresponding to the value at the given time.
-  // Search bounds can be constrained to a subset of the wave.
+  // Search bounds can be constrained to a subset of the wave. When searching
+  // repeatedly in the same wave, SampleStore::FindIndex() on the Wave() avoids
+  // the lookup by ID.
   int FindSampleIndex(uint64_t time, const Signal *signal, int left,
                       int right) const;
   // Variant that searches the whole wave.
   int FindSampleIndex(uint64_t time, const Signal *signal) const;
-  // Obtain the textual value of the signal at the given time.
+  // Obtain the textual value of the signal at the given time, or an empty
+  // string if there is no sample data.
   std::string FindSampleValue(uint64_t time, const Signal *signal) const;
+  // Values of the signals at the given time, in the same order, with empty
+  // strings for those without sample data. This doesn't load the waves: the
+  // Wave() is used if it covers the time, otherwise only what is needed for
+  // that one point in time is read.
+  std::vector<std::string> SignalValuesAt(
+      const std::vector<const Signal *> &signals, uint64_t time) const;
 
   // ------------- Implementation methods --------------
   // returns -9 for nanoseconds, -6 for microseconds, etc.
   virtual int Log10TimeUnits() const = 0;
   // Valid time range in the wave data.
   virtual std::pair<uint64_t, uint64_t> TimeRange() const = 0;
+  // Implementations can keep reading the file in the background once the
+  // signal hierarchy is known. While they do, the TimeRange() grows and
+  // samples become available up to its end. Errors from reading in the
+  // background are rethrown from here.
+  virtual bool Loading() const { return false; }
   // Implementations use a batch processing variant of wave loading, which is
   // generally a lot more efficient than reading the wave data for each signal
-  // separately.
-  virtual void LoadSignalSamples(const std::vector<const Signal *> &signals,
-                                 uint64_t start_time,
-                                 uint64_t end_time) const = 0;
+  // separately. The samples of the signals over (at least) the time range go
+  // to new entries in waves, and the returned time is the one through which
+  // they are complete. That is before end_time only while Loading(), and no
+  // entries are added if the range starts past what is available. This
+  // doesn't touch the loaded waves, and must be safe to call from a background
+  // thread while those are in use. See WaveLoader.
+  virtual uint64_t ReadSignalSamples(const std::vector<const Signal *> &signals,
+                                     uint64_t start_time, uint64_t end_time,
+                                     WaveMap *waves) const = 0;
+  // Point query behind SignalValuesAt(). The default reads the samples of the
+  // signals over just that time, formats that have a cheaper way to get at
+  // single values can override it.
+  virtual std::vector<std::string> ReadSignalValues(
+      const std::vector<const Signal *> &signals, uint64_t time) const;
   virtual void Reload() = 0;
 
   virtual ~WaveData() {}
@@ -101,11 +164,27 @@ class WaveData {
   // Not directly constructable.
   WaveData(const std::string &file_name, bool keep_glitches)
       : file_name_(file_name), keep_glitches_(keep_glitches) {}
-  // Traverse the scopes and signals and assign parents. This can only be done
-  // after the structure has been fully created, since the parents are pointers
-  // to elements of vectors, and thus could be invalidated (point to garbage) if
-  // the signal and scope children vectors are modified.
-  void BuildParents();
+  // Implementations build the hierarchy with these, in file order. Names are
+  // interned, since the same ones tend to appear in many scopes. Once done,
+  // FinishHierarchy() lays out the scopes such that the children and signals
+  // of each are contiguous, and links up the parents.
+  void BeginScope(std::string_view name);
+  void EndScope();
+  // Returns nullptr if there is no open scope. The signal can be filled in
+  // until the next call.
+  Signal *AddSignal(std::string_view name);
+  void FinishHierarchy();
+  void ClearHierarchy();
+  struct LoadedWave {
+    SampleStore samples;
+    // Time range over which the samples are complete. Starts out empty.
+    uint64_t valid_start_time = std::numeric_limits<uint64_t>::max();
+    uint64_t valid_end_time = 0;
+    // Value of use_count_ when last used.
+    uint64_t last_use = 0;
+  };
+  // Drops the least recently used waves while over the memory limit.
+  void EvictWaves() const;
   // Waveform data is stored per ID, which is potentially a subset of signals
   // in the wave. This avoids the need to hold copies of identical waveforms
   // for signals who are aliases of eachother. The canonical example here is
@@ -114,9 +193,44 @@ class WaveData {
   // This is marked mutable so that classes that hold a const reference or
   // pointer to this WaveData object can index the map (which is a non-const
   // operation since it may create new empty vectors for new IDs).
-  mutable absl::flat_hash_map<uint32_t, std::vector<Sample>> waves_;
-  // Signals owned from here.
-  std::vector<SignalScope> roots_;
+  mutable absl::flat_hash_map<uint32_t, LoadedWave> waves_;
+  mutable uint64_t use_count_ = 0;
+  mutable uint64_t in_use_since_ = 0;
+  static uint64_t memory_limit_;
+  // Signals owned from here. The roots come first in scopes_, then the
+  // children of each scope in turn.
+  StringPool names_;
+  std::vector<SignalScope> scopes_;
+  int num_roots_ = 0;
+  std::vector<Signal> signals_;
+  // State while building the hierarchy, as indices into new_scopes_.
+  struct NewScope {
+    std::string_view name;
+    int parent;
+  };
+  std::vector<NewScope> new_scopes_;
+  std::vector<int> new_signal_scopes_;
+  std::vector<int> open_scopes_;
+  // Index of the signals by full path. Only the hashes of the paths are kept,
+  // lookups compare the path against the names in the hierarchy.
+  struct PathEntry {
+    uint64_t hash;
+    const Signal *signal;
+  };
+  struct PathHash {
+    using is_transparent = void;
+    size_t operator()(const PathEntry &entry) const { return entry.hash; }
+    size_t operator()(std::string_view path) const;
+  };
+  struct PathEq {
+    using is_transparent = void;
+    bool operator()(const PathEntry &a, const PathEntry &b) const;
+    bool operator()(const PathEntry &entry, std::string_view path) const;
+    bool operator()(std::string_view path, const PathEntry &entry) const {
+      return (*this)(entry, path);
+    }
+  };
+  absl::flat_hash_set<PathEntry, PathHash, PathEq> signals_by_path_;
   // File name saved for convenience, for reloads etc.
   std::string file_name_;
   // When false, glitches are stripped from the wave data.
@@ -0,0 +1,145 @@
+#include "wave_loader.h"
+#include <algorithm>
+
+namespace sv {
+namespace {
+// Requests are read in about this many slices.
+constexpr int kNumSlices = 8;
+} // namespace
+
+WaveLoader::WaveLoader(const WaveData *wave_data)
+    : wave_data_(wave_data), thread_([this] { Run(); }) {}
+
+WaveLoader::~WaveLoader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    generation_++;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+void WaveLoader::Load(const std::vector<const WaveData::Signal *> &signals,
+                      uint64_t start_time, uint64_t end_time) {
+  // Only the part that isn't loaded yet needs reading, as long as that's the
+  // end of the range for all signals.
+  uint64_t read_start = end_time;
+  bool append = true;
+  for (const auto *s : signals) {
+    const auto valid_end_time = wave_data_->ValidEndTime(s, start_time);
+    if (!valid_end_time) {
+      append = false;
+      break;
+    }
+    if (*valid_end_time < end_time) {
+      read_start = std::min(read_start, *valid_end_time + 1);
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    generation_++;
+    // Slices of the previous request that are still to be applied can replace
+    // the waves this was based on.
+    if (!slices_.empty()) append = false;
+    if (!append) read_start = start_time;
+    requests_.clear();
+    requests_.push_back(Request{signals, read_start, end_time, append,
+                                /*load_start_time*/ start_time});
+  }
+  rereading_.clear();
+  cv_.notify_all();
+}
+
+bool WaveLoader::Apply() {
+  std::vector<Slice> slices;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slices.swap(slices_);
+  }
+  for (auto &slice : slices) {
+    if (slice.error) std::rethrow_exception(slice.error);
+    if (!slice.append) {
+      for (const auto *s : slice.signals) rereading_.erase(s);
+    }
+    std::vector<const WaveData::Signal *> reread;
+    for (const auto *s : wave_data_->ApplySignalSamples(
+             slice.signals, slice.start_time, slice.valid_end_time,
+             &slice.waves, slice.append)) {
+      if (rereading_.insert(s).second) reread.push_back(s);
+    }
+    if (reread.empty()) continue;
+    // Queued behind the current request, which may still need the reader.
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      requests_.push_back(Request{reread, slice.load_start_time,
+                                  slice.load_end_time, /*append*/ false,
+                                  slice.load_start_time});
+    }
+    cv_.notify_all();
+  }
+  return !slices.empty();
+}
+
+bool WaveLoader::Busy() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return !requests_.empty() || reading_ || !slices_.empty();
+}
+
+void WaveLoader::Cancel() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  generation_++;
+  requests_.clear();
+  slices_.clear();
+  rereading_.clear();
+  cv_.wait(lock, [this] { return !reading_; });
+}
+
+void WaveLoader::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this] { return stop_ || !requests_.empty(); });
+    if (stop_) return;
+    const Request request = std::move(requests_.front());
+    requests_.pop_front();
+    const uint64_t generation = generation_;
+    const uint64_t slice_size =
+        std::max<uint64_t>(1, (request.end_time - request.start_time) /
+                                  kNumSlices);
+    reading_ = true;
+    uint64_t start_time = request.start_time;
+    while (generation == generation_) {
+      Slice slice;
+      slice.signals = request.signals;
+      slice.start_time = start_time;
+      slice.append = request.append || start_time != request.start_time;
+      slice.load_start_time = request.load_start_time;
+      slice.load_end_time = request.end_time;
+      const uint64_t end_time =
+          request.end_time - start_time <= slice_size
+              ? request.end_time
+              : start_time + slice_size - 1;
+      lock.unlock();
+      try {
+        slice.valid_end_time = wave_data_->ReadSignalSamples(
+            slice.signals, start_time, end_time, &slice.waves);
+      } catch (...) {
+        slice.error = std::current_exception();
+      }
+      lock.lock();
+      if (generation != generation_) break;
+      // Samples can stop short of the slice when the wave data doesn't have
+      // any more yet. There is no point in reading further then.
+      const bool done = slice.error ||
+                        slice.valid_end_time >= request.end_time ||
+                        slice.valid_end_time < end_time;
+      slices_.push_back(std::move(slice));
+      if (done) break;
+      start_time = std::max(end_time, slices_.back().valid_end_time) + 1;
+    }
+    reading_ = false;
+    cv_.notify_all();
+  }
+}
+
+} // namespace sv
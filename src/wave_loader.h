@@ -0,0 +1,87 @@
+#pragma once
+
+#include "absl/container/flat_hash_set.h"
+#include "wave_data.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sv {
+
+// Loads wave samples on a background thread, so that the UI stays responsive
+// while large wave files are read. The requested time range is read in a few
+// consecutive slices, and each slice can be applied to the wave data as soon as
+// it has been read, so that waves are drawn progressively.
+//
+// The loaded waves are only modified from Apply(). As long as that is called
+// from the UI thread, the UI can keep using the wave data without locking.
+class WaveLoader {
+ public:
+  explicit WaveLoader(const WaveData *wave_data);
+  ~WaveLoader();
+  // Starts loading samples for the signals over the time range. This replaces
+  // any load still in progress: slices already read from that one still get
+  // applied, the rest is dropped. If the waves of all signals already cover
+  // the start of the range, they are continued from where they end instead.
+  // The load stops early at the end of what the wave data has available so
+  // far, see WaveData::Loading(). Waves that are evicted while they are being
+  // continued are read again over the whole range.
+  void Load(const std::vector<const WaveData::Signal *> &signals,
+            uint64_t start_time, uint64_t end_time);
+  // Applies the slices read since the last call. Returns true if there were
+  // any. Errors from reading the wave data are rethrown from here.
+  bool Apply();
+  // True while there is something left to Apply().
+  bool Busy() const;
+  // Drops everything not applied yet, and waits until the wave data is no
+  // longer being read. Must be called before the wave data is reloaded.
+  void Cancel();
+
+ private:
+  void Run();
+
+  struct Request {
+    std::vector<const WaveData::Signal *> signals;
+    uint64_t start_time;
+    uint64_t end_time;
+    // Continue the current waves rather than replacing them.
+    bool append;
+    // The whole range asked for, start_time is later when appending.
+    uint64_t load_start_time;
+  };
+  struct Slice {
+    std::vector<const WaveData::Signal *> signals;
+    uint64_t start_time;
+    uint64_t valid_end_time;
+    WaveData::WaveMap waves;
+    // Set for all but the first slice of a request, unless that continues the
+    // current waves too.
+    bool append;
+    // The whole range of the request, to read again if appending fails.
+    uint64_t load_start_time;
+    uint64_t load_end_time;
+    std::exception_ptr error;
+  };
+
+  const WaveData *wave_data_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  // The current request first, followed by the ones that read waves again.
+  std::deque<Request> requests_;
+  std::vector<Slice> slices_;
+  // Signals that are being read again, so that the rest of the slices that
+  // fail to continue them don't ask for that once more. Not used by the
+  // reading thread.
+  absl::flat_hash_set<const WaveData::Signal *> rereading_;
+  // Bumped to drop the work in progress.
+  uint64_t generation_ = 0;
+  bool reading_ = false;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+} // namespace sv
@@ -1,15 +1,40 @@
 #include "wave_signals_panel.h"
+#include "absl/strings/str_format.h"
 #include "color.h"
+#include "utils.h"
 #include "workspace.h"
 #include <algorithm>
 #include <regex>
 
 namespace sv {
+namespace {
+// Found signals beyond this many are not listed.
+constexpr int kMaxFoundSignals = 1000;
+// Signals are matched against the filter in blocks of this many per thread.
+constexpr int kFilterBlockSize = 4096;
+} // namespace
 
 void WaveSignalsPanel::Draw() {
   TreePanel::Draw();
   // Draw the header.
   wmove(w_, 0, 0);
+  if (showing_found_) {
+    // The type toggles only apply to a scope.
+    SetColor(w_, kSignalFilterPair);
+    const std::string found =
+        num_found_ > items_.size()
+            ? absl::StrFormat(" %d of %d found", items_.size(), num_found_)
+            : absl::StrFormat(" %d found", num_found_);
+    waddnstr(w_, found.c_str(), getmaxx(w_));
+    wmove(w_, 1, 0);
+    if (editing_find_) {
+      find_input_.Draw(w_);
+    } else {
+      const std::string find = "find:" + find_text_;
+      waddnstr(w_, find.c_str(), getmaxx(w_));
+    }
+    return;
+  }
   const std::string toggles = " [net] [in] [out] [inout]";
   const bool flags[] = {hide_signals_, hide_inputs_, hide_outputs_,
                         hide_inouts_};
@@ -36,7 +61,8 @@ void WaveSignalsPanel::Draw() {
   }
 }
 
-WaveSignalsPanel::WaveSignalsPanel() : filter_input_("filter:") {
+WaveSignalsPanel::WaveSignalsPanel()
+    : filter_input_("filter:"), find_input_("find:") {
   if (Workspace::Get().Waves() == nullptr) return;
   if (Workspace::Get().Waves()->Roots().empty()) return;
   SetScope(&Workspace::Get().Waves()->Roots()[0]);
@@ -44,6 +70,7 @@ WaveSignalsPanel::WaveSignalsPanel() : filter_input_("filter:") {
   prepend_type_ = true;
   header_lines_ = 2;
   filter_input_.SetDims(1, 0, getmaxx(w_));
+  find_input_.SetDims(1, 0, getmaxx(w_));
 }
 
 std::pair<int, int> WaveSignalsPanel::ScrollArea() const {
@@ -52,44 +79,132 @@ std::pair<int, int> WaveSignalsPanel::ScrollArea() const {
   return {h - header_lines_, w};
 }
 
-void WaveSignalsPanel::Resized() { filter_input_.SetDims(1, 0, getmaxx(w_)); }
+void WaveSignalsPanel::Resized() {
+  filter_input_.SetDims(1, 0, getmaxx(w_));
+  find_input_.SetDims(1, 0, getmaxx(w_));
+}
 
 std::optional<std::pair<int, int>> WaveSignalsPanel::CursorLocation() const {
+  if (editing_find_) return find_input_.CursorPos();
   if (!editing_filter_) return std::nullopt;
   return filter_input_.CursorPos();
 }
 
+void WaveSignalsPanel::StartFind() {
+  editing_find_ = true;
+  find_input_.Reset();
+  Find("");
+}
+
+void WaveSignalsPanel::Find(const std::string &query) {
+  showing_found_ = true;
+  find_text_ = query;
+  data_.Clear();
+  items_.clear();
+  found_items_.clear();
+  for (const auto *signal : Workspace::Get().FindSignals(
+           query, kMaxFoundSignals, &num_found_)) {
+    found_items_.push_back(SignalTreeItem(signal, /*full_path*/ true));
+  }
+  for (auto &item : found_items_) {
+    items_.push_back(&item);
+    data_.AddRoot(&item);
+  }
+  SetLineAndScroll(0);
+}
+
 void WaveSignalsPanel::SetScope(const WaveData::SignalScope *s) {
-  scope_ = s;
+  if (s != scope_) {
+    scope_ = s;
+    scope_items_.clear();
+    sorted_.clear();
+    scope_items_.reserve(s->signals.size());
+    for (auto &sig : s->signals) {
+      scope_items_.push_back(SignalTreeItem(&sig));
+    }
+    const std::string text = filter_text_;
+    filter_text_.clear();
+    matched_.resize(scope_items_.size());
+    for (int i = 0; i < matched_.size(); ++i) matched_[i] = i;
+    Filter(text);
+  }
+  UpdateList();
+}
+
+void WaveSignalsPanel::Filter(const std::string &text) {
+  // Names that contain the extended text are among the ones that contained
+  // the text before, so only those need to be looked at again. Regular
+  // expressions don't narrow down like that.
+  const bool is_regex = !text.empty() && text[0] == '/';
+  const bool was_regex = !filter_text_.empty() && filter_text_[0] == '/';
+  if (is_regex || was_regex ||
+      text.find(filter_text_) == std::string::npos) {
+    matched_.resize(scope_items_.size());
+    for (int i = 0; i < matched_.size(); ++i) matched_[i] = i;
+  }
+  filter_text_ = text;
+  if (text.empty()) return;
+  // If the filter starts with a leading /, it's a regular expression. It is
+  // compiled once, and only read while matching.
+  std::regex r;
+  if (is_regex) {
+    try {
+      r = std::regex(text.substr(1));
+    } catch (const std::regex_error &) {
+      // Likely still being typed.
+      matched_.clear();
+      return;
+    }
+  }
+  std::vector<char> matches(matched_.size());
+  const int num_blocks =
+      (matched_.size() + kFilterBlockSize - 1) / kFilterBlockSize;
+  ParallelFor(num_blocks, [&](int block) {
+    const int end =
+        std::min<int>(matched_.size(), (block + 1) * kFilterBlockSize);
+    for (int i = block * kFilterBlockSize; i < end; ++i) {
+      const auto &name = scope_items_[matched_[i]].Signal()->name;
+      matches[i] = is_regex ? std::regex_search(name.begin(), name.end(), r)
+                            : name.find(text) != std::string::npos;
+    }
+  });
+  int num_matched = 0;
+  for (int i = 0; i < matched_.size(); ++i) {
+    if (matches[i]) matched_[num_matched++] = matched_[i];
+  }
+  matched_.resize(num_matched);
+}
+
+void WaveSignalsPanel::UpdateList() {
+  showing_found_ = false;
+  if (sort_ && sorted_.empty() && !scope_items_.empty()) {
+    sorted_.resize(scope_items_.size());
+    for (int i = 0; i < sorted_.size(); ++i) sorted_[i] = i;
+    std::sort(sorted_.begin(), sorted_.end(), [&](int a, int b) {
+      return scope_items_[a].Name() < scope_items_[b].Name();
+    });
+  }
+  std::vector<int> order;
+  if (sort_) {
+    std::vector<char> is_matched(scope_items_.size());
+    for (const int i : matched_) is_matched[i] = true;
+    order.reserve(matched_.size());
+    for (const int i : sorted_) {
+      if (is_matched[i]) order.push_back(i);
+    }
+  }
   data_.Clear();
   items_.clear();
-  for (auto &sig : s->signals) {
+  for (const int i : sort_ ? order : matched_) {
+    const auto &sig = *scope_items_[i].Signal();
     if ((hide_signals_ && sig.direction == WaveData::Signal::kInternal) ||
         (hide_outputs_ && sig.direction == WaveData::Signal::kOutput) ||
         (hide_inputs_ && sig.direction == WaveData::Signal::kInput) ||
         (hide_inouts_ && sig.direction == WaveData::Signal::kInout)) {
       continue;
     }
-    if (!filter_text_.empty()) {
-      // If the filter starts with a leading /, it's a regular expression.
-      if (filter_text_[0] == '/') {
-        std::regex r(filter_text_.substr(1));
-        if (!std::regex_search(sig.name, r)) continue;
-      } else {
-        // Skip anything that doesn't match.
-        if (sig.name.find(filter_text_) == std::string::npos) continue;
-      }
-    }
-    items_.push_back(SignalTreeItem(&sig));
-  }
-  if (sort_) {
-    std::sort(items_.begin(), items_.end(),
-              [](const SignalTreeItem &a, const SignalTreeItem &b) {
-                return a.Name() < b.Name();
-              });
-  }
-  for (auto &item : items_) {
-    data_.AddRoot(&item);
+    items_.push_back(&scope_items_[i]);
+    data_.AddRoot(&scope_items_[i]);
   }
   SetLineAndScroll(0);
 }
@@ -99,7 +214,7 @@ WaveSignalsPanel::SignalsForWaves() {
   if (!add_signals_) return std::nullopt;
   std::vector<const WaveData::Signal *> ret;
   for (int i = add_signal_range_.first; i <= add_signal_range_.second; ++i) {
-    ret.push_back(items_[i].Signal());
+    ret.push_back(items_[i]->Signal());
   }
   add_signals_ = false;
   return ret;
@@ -107,15 +222,28 @@ WaveSignalsPanel::SignalsForWaves() {
 
 void WaveSignalsPanel::UIChar(int ch) {
   bool cancel_multi_line = true;
-  if (editing_filter_) {
+  if (editing_find_) {
+    const auto state = find_input_.HandleKey(ch);
+    if (state == TextInput::kCancelled) {
+      // Back to the signals of the scope.
+      editing_find_ = false;
+      UpdateList();
+    } else {
+      editing_find_ = state == TextInput::kTyping;
+      // The list follows what is typed.
+      if (find_input_.Text() != find_text_) Find(find_input_.Text());
+    }
+  } else if (editing_filter_) {
     const auto state = filter_input_.HandleKey(ch);
-    if (state != TextInput::kTyping) {
-      editing_filter_ = false;
-      if (state == TextInput::kDone) {
-        filter_text_ = filter_input_.Text();
-        // Re-process the current scope.
-        SetScope(scope_);
-      }
+    editing_filter_ = state == TextInput::kTyping;
+    // The list follows what is typed.
+    const std::string &text = state == TextInput::kCancelled
+                                  ? filter_text_before_edit_
+                                  : filter_input_.Text();
+    if (state == TextInput::kCancelled) filter_input_.SetText(text);
+    if (text != filter_text_) {
+      Filter(text);
+      UpdateList();
     }
   } else {
     switch (ch) {
@@ -144,26 +272,30 @@ void WaveSignalsPanel::UIChar(int ch) {
           add_all ? items_.size() - 1 : std::max(line_idx_, mult);
       add_signals_ = true;
     } break;
-    case 'f': editing_filter_ = true; break;
+    case 'f':
+      editing_filter_ = true;
+      filter_text_before_edit_ = filter_text_;
+      break;
+    case 'F': StartFind(); break;
     case '1':
       hide_signals_ = !hide_signals_;
-      SetScope(scope_);
+      UpdateList();
       break;
     case '2':
       hide_inputs_ = !hide_inputs_;
-      SetScope(scope_);
+      UpdateList();
       break;
     case '3':
       hide_outputs_ = !hide_outputs_;
-      SetScope(scope_);
+      UpdateList();
       break;
     case '4':
       hide_inouts_ = !hide_inouts_;
-      SetScope(scope_);
+      UpdateList();
       break;
     case 's':
       sort_ = !sort_;
-      SetScope(scope_);
+      UpdateList();
       break;
     default: TreePanel::UIChar(ch);
     }
@@ -175,6 +307,7 @@ std::vector<Tooltip> WaveSignalsPanel::Tooltips() const {
   std::vector<Tooltip> tt{{"w", "add to waves"},
                           {"W", "add all to waves"},
                           {"f", "filter"},
+                          {"F", "find in all scopes"},
                           {"1234", "toggle types"},
                           {"s", "toggle sort"}};
   return tt;
@@ -8,8 +8,9 @@
 namespace sv {
 
 // Lists all signals from a single hierarchy level out of the workspace wave
-// data. The TreePanel class is used for nice drawing and scrolling, but there
-// is no actual tree type data here, it's just a flat list.
+// data, or the ones found anywhere in it by their path. The TreePanel class is
+// used for nice drawing and scrolling, but there is no actual tree type data
+// here, it's just a flat list.
 class WaveSignalsPanel : public TreePanel {
  public:
   WaveSignalsPanel();
@@ -21,12 +22,29 @@ class WaveSignalsPanel : public TreePanel {
   std::pair<int, int> ScrollArea() const final;
   std::optional<std::pair<int, int>> CursorLocation() const final;
   void Resized() final;
-  bool Modal() const final { return editing_filter_; }
+  bool Modal() const final { return editing_filter_ || editing_find_; }
   std::optional<std::vector<const WaveData::Signal *>> SignalsForWaves();
+  // Starts typing a query to find signals in all scopes. The list shows the
+  // best matches as the query is typed.
+  void StartFind();
 
  private:
-  const WaveData::SignalScope *scope_;
-  std::vector<SignalTreeItem> items_;
+  void Find(const std::string &query);
+  // Matches the signals of the scope against the filter text.
+  void Filter(const std::string &text);
+  // Lists the matching signals that pass the type toggles.
+  void UpdateList();
+
+  const WaveData::SignalScope *scope_ = nullptr;
+  // The signals of the scope, with their names formatted once per scope.
+  std::vector<SignalTreeItem> scope_items_;
+  // Positions in scope_items_ in name order, sorted when first needed.
+  std::vector<int> sorted_;
+  // Positions in scope_items_ that match filter_text_, in order.
+  std::vector<int> matched_;
+  std::vector<SignalTreeItem> found_items_;
+  // What is listed, out of either of the above.
+  std::vector<SignalTreeItem *> items_;
   bool add_signals_ = false;
   std::pair<int, int> add_signal_range_;
 
@@ -40,7 +58,16 @@ class WaveSignalsPanel : public TreePanel {
 
   TextInput filter_input_;
   std::string filter_text_;
+  // To go back to if the edit is cancelled.
+  std::string filter_text_before_edit_;
   bool editing_filter_ = false;
+
+  // Signals found in all scopes are shown instead of the scope's while set.
+  bool showing_found_ = false;
+  TextInput find_input_;
+  std::string find_text_;
+  bool editing_find_ = false;
+  int num_found_ = 0;
 };
 
 } // namespace sv
@@ -4,12 +4,9 @@
 namespace sv {
 
 WaveDataTreeItem::WaveDataTreeItem(const WaveData::SignalScope &signal_scope)
-    : signal_scope_(signal_scope) {
-  for (const auto &c : signal_scope_.children) {
-    children_.push_back(WaveDataTreeItem(c));
-  }
-}
-const std::string &WaveDataTreeItem::Name() const { return signal_scope_.name; }
+    : signal_scope_(signal_scope), name_(signal_scope.name) {}
+
+const std::string &WaveDataTreeItem::Name() const { return name_; }
 
 const std::string &WaveDataTreeItem::Type() const {
   static std::string empty;
@@ -18,11 +15,23 @@ const std::string &WaveDataTreeItem::Type() const {
 
 bool WaveDataTreeItem::AltType() const { return false; }
 
-bool WaveDataTreeItem::Expandable() const { return !children_.empty(); }
+bool WaveDataTreeItem::Expandable() const {
+  return !signal_scope_.children.empty();
+}
 
-int WaveDataTreeItem::NumChildren() const { return children_.size(); }
+int WaveDataTreeItem::NumChildren() const {
+  return signal_scope_.children.size();
+}
 
-TreeItem *WaveDataTreeItem::Child(int idx) { return &children_[idx]; }
+TreeItem *WaveDataTreeItem::Child(int idx) {
+  if (children_.empty()) {
+    children_.reserve(signal_scope_.children.size());
+    for (const auto &c : signal_scope_.children) {
+      children_.push_back(WaveDataTreeItem(c));
+    }
+  }
+  return &children_[idx];
+}
 
 bool WaveDataTreeItem::MatchColor() const {
   return &signal_scope_ == Workspace::Get().MatchedSignalScope();
@@ -22,6 +22,8 @@ class WaveDataTreeItem : public TreeItem {
 
  private:
   const WaveData::SignalScope &signal_scope_;
+  std::string name_;
+  // Only created once the item is expanded.
   std::vector<WaveDataTreeItem> children_;
 };
 
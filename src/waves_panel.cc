@@ -25,7 +25,10 @@ const char *kBlankMarkerInFile = "[blank]";
 
 WavesPanel::WavesPanel() : cursor_time_(Workspace::Get().WaveCursorTime()) {
   wave_data_ = Workspace::Get().Waves();
-  std::tie(left_time_, right_time_) = wave_data_->TimeRange();
+  wave_loader_ = std::make_unique<WaveLoader>(wave_data_);
+  Workspace::Get().AddWavesReloadHook(this, [this] { wave_loader_->Cancel(); });
+  time_range_ = wave_data_->TimeRange();
+  std::tie(left_time_, right_time_) = time_range_;
   for (int i = 0; i < 10; ++i) {
     numbered_marker_times_[i] = 0;
   }
@@ -50,6 +53,10 @@ WavesPanel::WavesPanel() : cursor_time_(Workspace::Get().WaveCursorTime()) {
   UpdateVisibleSignals();
 }
 
+WavesPanel::~WavesPanel() {
+  Workspace::Get().RemoveWavesReloadHook(this);
+}
+
 std::string WavesPanel::ListItem::Name() const {
   if (is_group) return group_name;
   if (signal == nullptr) {
@@ -62,7 +69,7 @@ std::string WavesPanel::ListItem::Name() const {
     }
     return unavailable_name.substr(pos);
   }
-  std::string s = signal->name;
+  std::string s(signal->name);
   if (expanded_bit_idx >= 0) {
     // Remove the suffix from expanded nets.
     if (signal->has_suffix) {
@@ -136,25 +143,24 @@ void WavesPanel::FindEdge(bool forward, bool *time_changed,
                           bool *range_changed) {
   if (visible_items_[line_idx_]->signal == nullptr) return;
   const auto &wave = wave_data_->Wave(visible_items_[line_idx_]->signal);
-  const int sample_idx = wave_data_->FindSampleIndex(
-      cursor_time_, visible_items_[line_idx_]->signal);
+  const int sample_idx = wave.FindIndex(cursor_time_);
   if (forward) {
     // No more data left.
-    const uint64_t current_time = wave[sample_idx].time;
+    const uint64_t current_time = wave.Time(sample_idx);
     int new_sample_idx = sample_idx + 1;
     while (new_sample_idx < wave.size() &&
-           wave[new_sample_idx].time == current_time) {
+           wave.Time(new_sample_idx) == current_time) {
       new_sample_idx++;
     }
     if (new_sample_idx >= wave.size()) return;
-    GoToTime(wave[new_sample_idx].time, time_changed, range_changed);
+    GoToTime(wave.Time(new_sample_idx), time_changed, range_changed);
   } else {
     // If on the edge, go the sample prior, if possible.
-    if (wave[sample_idx].time == cursor_time_) {
+    if (wave.Time(sample_idx) == cursor_time_) {
       if (sample_idx == 0) return;
-      GoToTime(wave[sample_idx - 1].time, time_changed, range_changed);
+      GoToTime(wave.Time(sample_idx - 1), time_changed, range_changed);
     } else {
-      GoToTime(wave[sample_idx].time, time_changed, range_changed);
+      GoToTime(wave.Time(sample_idx), time_changed, range_changed);
     }
   }
 }
@@ -167,17 +173,17 @@ void WavesPanel::SnapToValue() {
   // See if there is an edge within the current cursor's character span
   const uint64_t left_time = left_time_ + cursor_pos_ * time_per_char;
   const uint64_t right_time = left_time_ + (cursor_pos_ + 1) * time_per_char;
-  const int left_idx = wave_data_->FindSampleIndex(left_time, item->signal);
-  const int right_idx = wave_data_->FindSampleIndex(right_time, item->signal);
+  const int left_idx = wave.FindIndex(left_time);
+  const int right_idx = wave.FindIndex(right_time, left_idx);
   // Nothing to snap to if there is no transition within this character.
   if (left_idx == right_idx) return;
   // Find transition closest to left edge, but not before.
   int idx = left_idx;
-  while (wave[idx].time < left_time) {
+  while (wave.Time(idx) < left_time) {
     idx++;
   }
   // Update the cursor's time to the precise edge.
-  cursor_time_ = wave[idx].time;
+  cursor_time_ = wave.Time(idx);
 }
 
 std::optional<std::pair<int, int>> WavesPanel::CursorLocation() const {
@@ -420,7 +426,7 @@ void WavesPanel::Draw() {
     }
     const bool multi_bit =
         item->signal->width > 1 && item->expanded_bit_idx < 0;
-    int left_sample_idx = wave_data_->FindSampleIndex(left_time_, item->signal);
+    int left_sample_idx = wave.FindIndex(left_time_);
     // Save the locations of transitions and times to fill in values.
     struct WaveValueInfo {
       int xpos;
@@ -437,11 +443,9 @@ void WavesPanel::Draw() {
     // Determine initial color.
     if (item->custom_color >= 0) {
       SetColor(w_, kWavesCustomPair + 2 * item->custom_color + highlight);
-    } else if (wave[left_sample_idx].value.find_first_of("xX") !=
-               std::string::npos) {
+    } else if (wave.HasX(left_sample_idx)) {
       SetColor(w_, kWavesXPair + highlight);
-    } else if (wave[left_sample_idx].value.find_first_of("zZ") !=
-               std::string::npos) {
+    } else if (wave.HasZ(left_sample_idx)) {
       SetColor(w_, kWavesZPair + highlight);
     } else {
       SetColor(w_, kWavesWaveformPair + highlight);
@@ -449,19 +453,15 @@ void WavesPanel::Draw() {
     // Draw charachter by charachter
     wmove(w_, row, wave_x);
     for (int x = 0; x < max_w - wave_x; ++x) {
-      // Find what sample index corresponds to the right edge of this character.
-      const int right_sample_idx = wave_data_->FindSampleIndex(
-          left_time_ + (1 + x) * time_per_char, item->signal, left_sample_idx,
-          wave.size() - 1);
+      // Find what sample index corresponds to the right edge of this character,
+      // searching forward from the left edge.
+      const int right_sample_idx =
+          wave.FindIndex(left_time_ + (1 + x) * time_per_char, left_sample_idx);
       int num_transitions = right_sample_idx - left_sample_idx;
       if (num_transitions > 0) {
-        // See if anything has X or Z in it. Scan only the new values.
-        bool has_x = false;
-        bool has_z = false;
-        for (int i = left_sample_idx + 1; i <= right_sample_idx; ++i) {
-          has_x |= wave[i].value.find_first_of("xX") != std::string::npos;
-          has_z |= wave[i].value.find_first_of("zZ") != std::string::npos;
-        }
+        // See if anything has X or Z in it. Check only the new values.
+        bool has_x, has_z;
+        wave.FindXZ(left_sample_idx + 1, right_sample_idx, &has_x, &has_z);
         // Update color.
         if (item->custom_color >= 0) {
           SetColor(w_, kWavesCustomPair + 2 * item->custom_color + highlight);
@@ -481,12 +481,12 @@ void WavesPanel::Draw() {
           // Only save value locations if they are at least 3 characters.
           if (x - wvi.xpos >= 3) {
             wvi.size = x - wvi.xpos;
-            wvi.value = FormatValue(wave[wave_value_idx].value, item->radix,
+            wvi.value = FormatValue(wave.Value(wave_value_idx), item->radix,
                                     leading_zeroes_, /*drop_size*/ true);
             wave_value_list.push_back(wvi);
           }
           wvi.xpos = x + 1;
-          wvi.time = wave[right_sample_idx].time;
+          wvi.time = wave.Time(right_sample_idx);
           wave_value_idx = right_sample_idx;
         }
       } else {
@@ -494,19 +494,15 @@ void WavesPanel::Draw() {
         if (item->expanded_bit_idx >= 0) {
           value_idx = item->signal->width - item->expanded_bit_idx - 1;
           if (num_transitions > 0) {
-            num_transitions = 0;
-            for (int i = left_sample_idx + 1; i <= right_sample_idx; ++i) {
-              if (wave[i - 1].value[value_idx] != wave[i].value[value_idx]) {
-                num_transitions++;
-              }
-            }
+            // Only zero, one or more transitions are drawn differently.
+            num_transitions = wave.BitTransitions(
+                left_sample_idx, right_sample_idx, value_idx, /*max_count*/ 2);
           }
         }
         if (num_transitions == 0) {
-          waddch(w_, wave[left_sample_idx].value[value_idx] == '0' ? '_' : '^');
+          waddch(w_, wave.Bit(left_sample_idx, value_idx) == '0' ? '_' : '^');
         } else if (num_transitions == 1) {
-          waddch(w_,
-                 wave[left_sample_idx].value[value_idx] == '0' ? '/' : '\\');
+          waddch(w_, wave.Bit(left_sample_idx, value_idx) == '0' ? '/' : '\\');
         } else {
           waddch(w_, '|');
         }
@@ -516,7 +512,7 @@ void WavesPanel::Draw() {
     // Add the remaining wave value if possible, sized against the right edge.
     if (multi_bit && max_w - wave_x - wvi.xpos >= 3) {
       wvi.size = max_w - wave_x - wvi.xpos;
-      wvi.value = FormatValue(wave[wave_value_idx].value, item->radix,
+      wvi.value = FormatValue(wave.Value(wave_value_idx), item->radix,
                               leading_zeroes_, /*drop_size*/ true);
       wave_value_list.push_back(wvi);
     }
@@ -874,16 +870,17 @@ void WavesPanel::AddSignals(
                     : prev->depth;
   }
   int pos = visible_to_full_lookup_[line_idx_];
-  // It's much more efficient to get samples from all signals at once, so no
-  // repeated calls to UpdateWave() here.
-  wave_data_->LoadSignalSamples(signals, left_time_, right_time_);
   for (const auto *signal : signals) {
     items_.insert(items_.begin() + pos, ListItem(signal));
     items_[pos].depth = new_depth;
-    UpdateValue(&items_[pos]);
     pos++;
   }
   UpdateVisibleSignals();
+  // It's much more efficient to get samples from all signals at once, so no
+  // repeated calls to UpdateWave() here. UpdateWaves() picks up all signals
+  // that need samples.
+  UpdateWaves();
+  UpdateValues();
   // Move the insert position down, so things generally just nicely append.
   // Only if this isn't a new blank/group.
   if (signals.size() > 1 || signals[0] != nullptr) {
@@ -1058,14 +1055,14 @@ void WavesPanel::UpdateValue(ListItem *item) {
   if (item->signal == nullptr) return;
   auto &wave = wave_data_->Wave(item->signal);
   if (wave.empty()) {
-    item->value = "Unavailable";
+    item->value = wave_loader_->Busy() ? "Loading" : "Unavailable";
     return;
   }
-  const uint64_t idx = wave_data_->FindSampleIndex(cursor_time_, item->signal);
+  const uint64_t idx = wave.FindIndex(cursor_time_);
   if (item->expanded_bit_idx >= 0) {
-    item->value = wave[idx].value[item->expanded_bit_idx];
+    item->value = wave.Bit(idx, item->expanded_bit_idx);
   } else {
-    item->value = FormatValue(wave[idx].value, item->radix, leading_zeroes_);
+    item->value = FormatValue(wave.Value(idx), item->radix, leading_zeroes_);
   }
 }
 
@@ -1081,16 +1078,31 @@ void WavesPanel::UpdateWaves() {
   for (auto *item : visible_items_) {
     if (item->signal == nullptr) continue;
     // Skip the update if all the data is already present.
-    if (item->signal->valid_start_time <= left_time_ &&
-        item->signal->valid_end_time >= right_time_) {
+    if (wave_data_->SamplesValid(item->signal, left_time_, right_time_)) {
       continue;
     }
     signal_list.push_back(item->signal);
     items_to_update.push_back(item);
   }
   if (signal_list.empty()) return;
-  // Read new samples.
-  wave_data_->LoadSignalSamples(signal_list, left_time_, right_time_);
+  // Read new samples in the background, they show up as they are read.
+  wave_loader_->Load(signal_list, left_time_, right_time_);
+}
+
+void WavesPanel::UpdateLoadedWaves() {
+  // Values can also go from loading to unavailable without any new samples.
+  const bool was_loading = wave_loader_->Busy();
+  if (wave_loader_->Apply() || was_loading) UpdateValues();
+  // Pick up what the wave data read in the meantime.
+  const auto time_range = wave_data_->TimeRange();
+  if (time_range != time_range_) {
+    // Keep following the end if it was in view.
+    if (right_time_ >= time_range_.second && time_range.second > right_time_) {
+      right_time_ = time_range.second;
+    }
+    time_range_ = time_range;
+    UpdateWaves();
+  }
 }
 
 void WavesPanel::AddGroup() {
@@ -1226,8 +1238,8 @@ void WavesPanel::ReloadWaves() {
       signal_paths[i] = WaveData::SignalToPath(items_[i].signal);
     }
   }
-  // Do the actual reload...
-  Workspace::Get().Waves()->Reload();
+  // Do the actual reload. Background reads are cancelled first.
+  Workspace::Get().ReloadWaves();
   // Redo all the pointers.
   for (auto &[idx, path] : signal_paths) {
     auto &item = items_[idx];
@@ -4,6 +4,8 @@
 #include "radix.h"
 #include "text_input.h"
 #include "wave_data.h"
+#include "wave_loader.h"
+#include <memory>
 
 namespace sv {
 
@@ -13,6 +15,7 @@ namespace sv {
 class WavesPanel : public Panel {
  public:
   WavesPanel();
+  ~WavesPanel() override;
   void Draw() final;
   void UIChar(int ch) final;
   std::vector<Tooltip> Tooltips() const final;
@@ -26,6 +29,13 @@ class WavesPanel : public Panel {
   bool Searchable() const final { return true; }
   bool Search(bool search_down) final;
   std::optional<const WaveData::Signal *> SignalForSource();
+  // Waves are loaded in the background, and the wave data itself may still be
+  // read too. While this is true, the UI should call UpdateLoadedWaves()
+  // regularly, and redraw.
+  bool LoadingWaves() const {
+    return wave_loader_->Busy() || wave_data_->Loading();
+  }
+  void UpdateLoadedWaves();
 
  private:
   struct ListItem {
@@ -85,6 +95,8 @@ class WavesPanel : public Panel {
   uint64_t numbered_marker_times_[10];
   uint64_t left_time_ = 0;
   uint64_t right_time_ = 0;
+  // Last seen TimeRange() of the wave data, which grows while it's loading.
+  std::pair<uint64_t, uint64_t> time_range_;
   bool marker_selection_ = false;
   bool color_selection_ = false;
   TextInput time_input_;
@@ -103,6 +115,7 @@ class WavesPanel : public Panel {
   int name_value_size_ = 30;
   // Convenience to avoid repeated workspace Get() calls.
   const WaveData *wave_data_;
+  std::unique_ptr<WaveLoader> wave_loader_;
 };
 
 } // namespace sv
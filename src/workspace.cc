@@ -1,11 +1,19 @@
 #include "workspace.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "scope_matcher.h"
 #include "uhdm_utils.h"
 #include "utils.h"
+#include "wave_cache.h"
 
 #include <Surelog/Common/FileSystem.h>
+#include <algorithm>
+#include <filesystem>
+#include <functional>
 #include <iostream>
-#include <stack>
+#include <set>
 #include <stdexcept>
+#include <sys/stat.h>
 #include <uhdm/ElaboratorListener.h>
 #include <uhdm/array_net.h>
 #include <uhdm/array_var.h>
@@ -20,16 +28,68 @@ namespace sv {
 
 namespace {
 
-// Helper match, since the design names have a "work@" prefix.
-bool ScopeMatch(std::string_view design_scope, std::string_view signal_scope) {
-  auto pos = design_scope.find(signal_scope);
-  if (pos == std::string::npos) return false;
-  if (design_scope.size() == signal_scope.size() || pos == 0) return true;
-  return design_scope[pos - 1] == '@';
-};
+// Bump this whenever the design cache contents change.
+constexpr uint32_t kDesignCacheVersion = 1;
+
+// Everything the elaborated design depends on, to tell whether a saved
+// database is still up to date: the command line, which has the defines, and
+// the size and modification time of all files that Surelog may read.
+//
+// Includes are looked for in the include directories and in the directory of
+// the including file, with any subdirectories in the include name, so all
+// files below those are taken. Includes by absolute path, or relative to
+// directories that are neither, are still missed: use -no_design_cache when
+// those change.
+std::string DesignInputs(const SURELOG::CommandLineParser &clp, int argc,
+                         const char *argv[]) {
+  SURELOG::FileSystem *fs = SURELOG::FileSystem::getInstance();
+  std::vector<std::filesystem::path> paths;
+  std::set<std::filesystem::path> dirs;
+  // Arguments can name files too, like -f file lists.
+  for (int i = 1; i < argc; ++i) {
+    paths.push_back(argv[i]);
+  }
+  for (const auto *ids : {&clp.getSourceFiles(), &clp.getLibraryFiles()}) {
+    for (const auto &id : *ids) {
+      paths.push_back(fs->toPath(id));
+      dirs.insert(paths.back().parent_path());
+    }
+  }
+  for (const auto *ids : {&clp.getIncludePaths(), &clp.getLibraryPaths()}) {
+    for (const auto &id : *ids) {
+      dirs.insert(fs->toPath(id));
+    }
+  }
+  for (const auto &dir : dirs) {
+    std::error_code ec;
+    for (auto it = std::filesystem::recursive_directory_iterator(
+             dir.empty() ? "." : dir,
+             std::filesystem::directory_options::skip_permission_denied, ec);
+         !ec && it != std::filesystem::recursive_directory_iterator();
+         it.increment(ec)) {
+      paths.push_back(it->path());
+    }
+  }
+  std::set<std::string> files;
+  for (const auto &path : paths) {
+    std::error_code ec;
+    const auto file = std::filesystem::absolute(path, ec);
+    if (!ec) files.insert(file.lexically_normal().string());
+  }
+  std::string inputs = absl::StrJoin(argv + 1, argv + argc, "\n");
+  for (const auto &file : files) {
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+    absl::StrAppendFormat(&inputs, "\n%s %d %d.%09d", file, st.st_size,
+                          st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+  }
+  return inputs;
+}
 
 } // namespace
 
+bool Workspace::use_design_cache_ = true;
+
 const UHDM::module_inst *Workspace::GetDefinition(const UHDM::module_inst *m) {
   // Top modules don't have a separate definition.
   if (m->VpiTopModule()) return m;
@@ -58,7 +118,6 @@ bool Workspace::ParseDesign(int argc, const char *argv[]) {
   clp.setwritePpOutput(true);
   clp.setWriteUhdm(true);
   bool success = clp.parseCommandLine(argc, argv);
-  vpiHandle design = nullptr;
   if (!success || clp.help()) {
     if (!clp.help()) {
       std::cout << "Problems parsing arguments." << '\n';
@@ -66,40 +125,80 @@ bool Workspace::ParseDesign(int argc, const char *argv[]) {
     return false;
   }
   clp.setMuteStdout();
-  compiler_ = SURELOG::start_compiler(&clp);
-  design = SURELOG::get_uhdm_design(compiler_);
-  for (auto &err : errors.getErrors()) {
-    auto [msg, fatal, filtered] = errors.createErrorMessage(err);
-    if (msg.empty()) continue;
-    // It's complicated to find an error's severity...
-    auto map = SURELOG::ErrorDefinition::getErrorInfoMap();
-    auto err_info_it = map.find(err.getType());
-    // Skip notes, it's cluttery.
-    if (err_info_it == map.end() ||
-        err_info_it->second.m_severity !=
-            SURELOG::ErrorDefinition::ErrorSeverity::NOTE) {
-      std::cout << msg << '\n';
+  // Surelog saves the elaborated design, which loads much faster than it
+  // compiles. Reuse that if nothing changed since.
+  SURELOG::FileSystem *fs = SURELOG::FileSystem::getInstance();
+  const std::string db_path =
+      (std::filesystem::path(fs->toPath(clp.getCompileDirId())) /
+       "surelog.uhdm")
+          .string();
+  const std::string inputs = DesignInputs(clp, argc, argv);
+  if (use_design_cache_ && RestoreDesign(db_path, inputs)) {
+    std::cout << "Using the design database in " << db_path << '\n';
+  } else {
+    compiler_ = SURELOG::start_compiler(&clp);
+    vpiHandle design = SURELOG::get_uhdm_design(compiler_);
+    for (auto &err : errors.getErrors()) {
+      auto [msg, fatal, filtered] = errors.createErrorMessage(err);
+      if (msg.empty()) continue;
+      // It's complicated to find an error's severity...
+      auto map = SURELOG::ErrorDefinition::getErrorInfoMap();
+      auto err_info_it = map.find(err.getType());
+      // Skip notes, it's cluttery.
+      if (err_info_it == map.end() ||
+          err_info_it->second.m_severity !=
+              SURELOG::ErrorDefinition::ErrorSeverity::NOTE) {
+        std::cout << msg << '\n';
+      }
+    }
+    auto stats = errors.getErrorStats();
+    if (design == nullptr || /* stats.nbError > 0 i ||*/ stats.nbFatal > 0 ||
+        stats.nbSyntax > 0) {
+      std::cout << "Unable to parse the design!" << '\n';
+      return false;
+    }
+    // Pretty ugly cast here, both reinterpret and const...
+    design_ = (UHDM::design *)((uhdm_handle *)design)->object;
+    // The inputs are those from before compiling, in case files changed in
+    // the meantime.
+    if (use_design_cache_) {
+      WaveCacheWriter cache;
+      cache.WriteString(inputs);
+      cache.Save(db_path, kDesignCacheVersion);
     }
   }
-  auto stats = errors.getErrorStats();
-  if (design == nullptr || /* stats.nbError > 0 i ||*/ stats.nbFatal > 0 ||
-      stats.nbSyntax > 0) {
-    std::cout << "Unable to parse the design!" << '\n';
-    return false;
-  }
-  // Pretty ugly cast here, both reinterpret and const...
-  design_ = (UHDM::design *)((uhdm_handle *)design)->object;
 
   if (design_->TopModules()->empty()) {
     std::cout << "No top level design found!" << '\n';
     return false;
   }
 
-  SURELOG::FileSystem *fs = SURELOG::FileSystem::getInstance();
   for (const auto &id : clp.getIncludePaths()) {
     AddIncludeDir(fs->toPath(id));
   }
 
+  connectivity_thread_ = std::thread([this] {
+    auto connectivity = std::make_unique<ConnectivityGraph>(design_);
+    std::lock_guard<std::mutex> lock(connectivity_mutex_);
+    connectivity_ = std::move(connectivity);
+  });
+  return true;
+}
+
+bool Workspace::RestoreDesign(const std::string &db_path,
+                              std::string_view inputs) {
+  WaveCacheReader cache;
+  if (!cache.Open(db_path, kDesignCacheVersion)) return false;
+  try {
+    if (cache.ReadString() != inputs || !cache.AtEnd()) return false;
+  } catch (const std::runtime_error &e) {
+    return false;
+  }
+  auto serializer = std::make_unique<UHDM::Serializer>();
+  const std::vector<vpiHandle> designs = serializer->Restore(db_path);
+  if (designs.empty() || designs[0] == nullptr) return false;
+  design_ = (UHDM::design *)((uhdm_handle *)designs[0])->object;
+  serializer_ = std::move(serializer);
   return true;
 }
 
@@ -109,273 +208,244 @@ bool Workspace::ReadWaves(const std::string &wave_file, bool keep_glitches) {
   } catch (std::runtime_error &e) {
     return false;
   }
-  return wave_data_ != nullptr;
+  if (wave_data_ == nullptr) return false;
+  IndexSignals();
+  return true;
 }
 
-Workspace::~Workspace() {
-  if (compiler_ != nullptr) SURELOG::shutdown_compiler(compiler_);
-  delete design_;
+const ConnectivityGraph *Workspace::Connectivity() const {
+  std::lock_guard<std::mutex> lock(connectivity_mutex_);
+  return connectivity_.get();
 }
 
-void Workspace::TryMatchDesignWithWaves() {
-  // Don't do anything unless there are both waves and design.
-  if (wave_data_ == nullptr || design_ == nullptr) return;
-  // Look for a scope with stuff in it.
-  std::vector<const WaveData::SignalScope *> signal_scopes;
-  for (const auto &root_scope : wave_data_->Roots()) {
-    signal_scopes.push_back(&root_scope);
-    for (const auto &sub : root_scope.children) {
-      signal_scopes.push_back(&sub);
-      for (const auto &subsub : sub.children) {
-        signal_scopes.push_back(&subsub);
-      }
-    }
+void Workspace::ReloadWaves() {
+  WaitForSignalMap();
+  WaitForSignalIndex();
+  // Find the matched scope again by its path.
+  std::vector<std::string> path;
+  for (auto *s = matched_signal_scope_; s != nullptr; s = s->parent) {
+    path.emplace_back(s->name);
   }
-  // Okay, good enough. Now try to build a list of design scopes that look
-  // interesting. Not considering generate blocks here for the auto-detect.
-  std::vector<const UHDM::any *> design_scopes;
-  for (const auto *top : *design_->TopModules()) {
-    design_scopes.push_back(top);
-    // If the top module has some guts, add it's modules too.
-    if (top->Modules() != nullptr && !top->Modules()->empty()) {
-      for (const auto *sub : *top->Modules()) {
-        design_scopes.push_back(sub);
-        if (sub->Modules() != nullptr && !sub->Modules()->empty()) {
-          for (const auto *subsub : *sub->Modules()) {
-            design_scopes.push_back(subsub);
-          }
-        }
-      }
-    }
-  }
-  // Try to match the two candidate scopes against each other by looking for
-  // matching signals.
-  int max_common = 0;
-  for (const auto *design_scope : design_scopes) {
-    const auto *m = dynamic_cast<const UHDM::module_inst *>(design_scope);
-    for (const auto *signal_scope : signal_scopes) {
-      if (signal_scope->signals.empty()) continue;
-      int num_common_signals = 0;
-      if (m->Nets() != nullptr) {
-        for (const auto *n : *m->Nets()) {
-          for (const auto &s : signal_scope->signals) {
-            if (n->VpiName() == s.name) {
-              num_common_signals++;
-            }
-          }
-        }
-      }
-      if (m->Variables() != nullptr) {
-        for (const auto *v : *m->Variables()) {
-          for (const auto &s : signal_scope->signals) {
-            if (v->VpiName() == s.name) {
-              num_common_signals++;
-            }
-          }
-        }
-      }
-      // Save the best result.
-      if (num_common_signals > max_common) {
-        max_common = num_common_signals;
-        matched_design_scope_ = design_scope;
-        matched_signal_scope_ = signal_scope;
-      }
+  for (const auto &[owner, hook] : reload_hooks_) hook();
+  wave_data_->Reload();
+  matched_signal_scope_ = nullptr;
+  absl::Span<const WaveData::SignalScope> scopes = wave_data_->Roots();
+  for (auto it = path.rbegin(); it != path.rend(); ++it) {
+    const auto match = std::find_if(
+        scopes.begin(), scopes.end(),
+        [&](const WaveData::SignalScope &s) { return s.name == *it; });
+    if (match == scopes.end()) {
+      matched_signal_scope_ = nullptr;
+      break;
     }
+    matched_signal_scope_ = &*match;
+    scopes = match->children;
   }
   ApplyDesignData(matched_design_scope_, matched_signal_scope_);
+  UpdateSignalMap();
+  IndexSignals();
 }
 
-std::vector<const WaveData::Signal *>
-Workspace::DesignToSignals(const UHDM::any *item) const {
-  if (matched_signal_scope_ == nullptr) return {};
-  std::vector<const WaveData::Signal *> signals;
-  // Make sure it's actually something that would have ended up in a wave.
-  if (!IsTraceable(item)) return signals;
-  // Build a stack of all parents up to the top module, or the matched design
-  // scope, whichever comes first.
-  std::stack<const UHDM::any *> stack;
-  const UHDM::any *parent = item->VpiParent();
-  while (parent != nullptr) {
-    // Drop out any genscopes, there's always a genscope_array above it.
-    if (parent->VpiType() == vpiGenScope) parent = parent->VpiParent();
-    if (parent == matched_design_scope_) break;
-    stack.push(parent);
-    parent = parent->VpiParent();
-  }
+void Workspace::AddWavesReloadHook(const void *owner,
+                                   std::function<void()> hook) {
+  reload_hooks_.emplace_back(owner, std::move(hook));
+}
 
-  const WaveData::SignalScope *signal_scope = matched_signal_scope_;
-  while (!stack.empty()) {
-    auto *design_scope = stack.top();
-    bool found = false;
-    if (ScopeMatch(design_scope->VpiName(), signal_scope->name)) {
-      found = true;
-    } else {
-      for (const auto &sub : signal_scope->children) {
-        if (ScopeMatch(design_scope->VpiName(), sub.name)) {
-          signal_scope = &sub;
-          found = true;
-          break;
-        }
-      }
-    }
-    // Total abort if there is no matching scope in the wave data.
-    if (!found) return signals;
-    stack.pop();
-  }
-  // Now add any signals in the drilled-down scope that match the net name
-  // exactly, with optional square bracket suffixes.
-  const std::string net_name = StripWorklib(item->VpiName());
-  for (const auto &signal : signal_scope->signals) {
-    auto pos = signal.name.find(StripWorklib(item->VpiName()));
-    if (pos != 0) continue;
-    if (signal.name.size() > net_name.size() &&
-        signal.name[net_name.size()] != '[') {
-      continue;
-    }
-    signals.push_back(&signal);
-  }
+void Workspace::RemoveWavesReloadHook(const void *owner) {
+  reload_hooks_.erase(
+      std::remove_if(reload_hooks_.begin(), reload_hooks_.end(),
+                     [&](const auto &entry) { return entry.first == owner; }),
+      reload_hooks_.end());
+}
 
-  return signals;
+Workspace::~Workspace() {
+  if (connectivity_thread_.joinable()) connectivity_thread_.join();
+  WaitForSignalMap();
+  WaitForSignalIndex();
+  if (compiler_ != nullptr) SURELOG::shutdown_compiler(compiler_);
+  // A restored design belongs to its serializer.
+  if (serializer_ == nullptr) delete design_;
 }
 
-const UHDM::any *
-Workspace::SignalToDesign(const WaveData::Signal *signal) const {
-  if (matched_design_scope_ == nullptr) return nullptr;
-  // Build a stack of all parents up to the root, or the matched signal scope,
-  // whichever comes first.
-  std::stack<const WaveData::SignalScope *> stack;
-  const auto *scope = signal->scope;
-  while (scope != nullptr) {
-    if (scope == matched_signal_scope_) break;
-    stack.push(scope);
-    scope = scope->parent;
-  }
-  // Traverse the stack down the design tree hierarcy.
-  const UHDM::any *design_scope = matched_design_scope_;
-  while (design_scope != nullptr && !stack.empty()) {
-    auto *signal_scope = stack.top();
-    // Running the search as an anonoymous lambda allows for an easier exit out
-    // of next loops when the hierarchy item is found. An alternative would be a
-    // goto statement.
-    [&] {
-      if (ScopeMatch(design_scope->VpiName(), signal_scope->name)) {
-        return;
-      } else if (design_scope->VpiType() == vpiModule) {
-        const auto *m = dynamic_cast<const UHDM::module_inst *>(design_scope);
-        if (m->Modules() != nullptr) {
-          for (const auto *sub : *m->Modules()) {
-            if (ScopeMatch(sub->VpiName(), signal_scope->name)) {
-              design_scope = sub;
-              return;
+void Workspace::TryMatchDesignWithWaves() {
+  // Don't do anything unless there are both waves and design.
+  if (wave_data_ == nullptr || design_ == nullptr) return;
+  auto without_lib = [](std::string_view name) {
+    const auto pos = name.find('@');
+    return pos == std::string_view::npos ? name : name.substr(pos + 1);
+  };
+  // Flatten the design hierarchy, with generate blocks as their own scopes.
+  std::vector<MatchScope> design_scopes;
+  std::vector<const UHDM::any *> design_items;
+  std::function<void(const UHDM::any *, const UHDM::any *, int)> add_design =
+      [&](const UHDM::any *item, const UHDM::any *scope, int parent) {
+        MatchScope match = {.name = without_lib(item->VpiName()),
+                            .signal_names = {},
+                            .parent = parent};
+        const int idx = design_scopes.size();
+        std::vector<const UHDM::any *> subs;
+        auto add_contents = [&](const auto *s) {
+          if (s->Nets() != nullptr) {
+            for (const auto *n : *s->Nets()) {
+              match.signal_names.push_back(n->VpiName());
             }
           }
-        }
-        if (m->Gen_scope_arrays() != nullptr) {
-          for (const auto *ga : *m->Gen_scope_arrays()) {
-            // Surelog always has an unrolled list of gen scope arrays with a
-            // single generate scope as the only child.
-            const auto *g = (*ga->Gen_scopes())[0];
-            if (ScopeMatch(ga->VpiName(), signal_scope->name)) {
-              design_scope = g;
-              return;
+          if (s->Variables() != nullptr) {
+            for (const auto *v : *s->Variables()) {
+              match.signal_names.push_back(v->VpiName());
             }
           }
-        }
-      } else if (design_scope->VpiType() == vpiGenScope) {
-        // Nearly identical code to the above, but the Surelog classes don't
-        // have this virtualized.
-        const auto *g = dynamic_cast<const UHDM::gen_scope *>(design_scope);
-        if (g->Modules() != nullptr) {
-          for (const auto *sub : *g->Modules()) {
-            if (ScopeMatch(sub->VpiName(), signal_scope->name)) {
-              design_scope = sub;
-              return;
+          if (s->Array_nets() != nullptr) {
+            for (const auto *a : *s->Array_nets()) {
+              match.signal_names.push_back(a->VpiName());
+            }
+          }
+          if (s->Array_vars() != nullptr) {
+            for (const auto *a : *s->Array_vars()) {
+              match.signal_names.push_back(a->VpiName());
             }
           }
+          if (s->Modules() != nullptr) {
+            subs.insert(subs.end(), s->Modules()->begin(), s->Modules()->end());
+          }
+          if (s->Gen_scope_arrays() != nullptr) {
+            subs.insert(subs.end(), s->Gen_scope_arrays()->begin(),
+                        s->Gen_scope_arrays()->end());
+          }
+        };
+        if (scope->VpiType() == vpiModule) {
+          add_contents(dynamic_cast<const UHDM::module_inst *>(scope));
+        } else {
+          add_contents(dynamic_cast<const UHDM::gen_scope *>(scope));
         }
-        if (g->Gen_scope_arrays() != nullptr) {
-          for (const auto *ga : *g->Gen_scope_arrays()) {
-            const auto *g = (*ga->Gen_scopes())[0];
-            if (ScopeMatch(ga->VpiName(), signal_scope->name)) {
-              design_scope = g;
-              return;
+        design_scopes.push_back(std::move(match));
+        design_items.push_back(item);
+        for (const auto *sub : subs) {
+          if (sub->VpiType() == vpiModule) {
+            add_design(sub, sub, idx);
+          } else {
+            // Surelog always has an unrolled list of gen scope arrays with a
+            // single generate scope as the only child.
+            const auto *ga = dynamic_cast<const UHDM::gen_scope_array *>(sub);
+            if (ga->Gen_scopes() == nullptr || ga->Gen_scopes()->empty()) {
+              continue;
             }
+            add_design(ga, (*ga->Gen_scopes())[0], idx);
           }
         }
-      }
-      // Not considering anything else
-      design_scope = nullptr;
-    }();
-    stack.pop();
+      };
+  for (const auto *top : *design_->TopModules()) {
+    add_design(top, top, -1);
   }
-  // Bail out if there is no matching design.
-  if (design_scope == nullptr) return nullptr;
-  // Helper to match without [n] suffix, since the design does not contain
-  // unrolled net arrays.
-  auto array_match = [](std::string_view val,
-                        std::string_view val_with_suffix) {
-    const auto pos = val_with_suffix.find(val);
-    if (pos == std::string::npos) return false;
-    if (val.size() == val_with_suffix.size()) return true;
-    return val_with_suffix[val.size()] == '[';
-  };
-  // Look for nets, variables.
-  if (design_scope->VpiType() == vpiModule) {
-    const auto *m = dynamic_cast<const UHDM::module_inst *>(design_scope);
-    if (m->Nets() != nullptr) {
-      for (const auto *n : *m->Nets()) {
-        if (n->VpiName() == signal->name) return n;
-      }
-    }
-    if (m->Variables() != nullptr) {
-      for (const auto *v : *m->Variables()) {
-        if (v->VpiName() == signal->name) return v;
-      }
-    }
-    if (m->Array_nets() != nullptr) {
-      for (const auto *a : *m->Array_nets()) {
-        if (array_match(a->VpiName(), signal->name)) return a;
-      }
-    }
-    if (m->Array_vars() != nullptr) {
-      for (const auto *a : *m->Array_vars()) {
-        if (array_match(a->VpiName(), signal->name)) return a;
-      }
-    }
-  } else if (design_scope->VpiType() == vpiGenScope) {
-    const auto *g = dynamic_cast<const UHDM::gen_scope *>(design_scope);
-    if (g->Nets() != nullptr) {
-      for (const auto *n : *g->Nets()) {
-        if (n->VpiName() == signal->name) return n;
-      }
-    }
-    if (g->Variables() != nullptr) {
-      for (const auto *v : *g->Variables()) {
-        if (v->VpiName() == signal->name) return v;
-      }
+  // And the wave hierarchy, matching arrays and bit-blasted vectors by their
+  // base name.
+  std::vector<MatchScope> signal_scopes;
+  std::vector<const WaveData::SignalScope *> signal_scope_ptrs;
+  std::function<void(const WaveData::SignalScope &, int)> add_signals =
+      [&](const WaveData::SignalScope &scope, int parent) {
+        MatchScope match = {.name = scope.name,
+                            .signal_names = {},
+                            .parent = parent};
+        for (const auto &signal : scope.signals) {
+          match.signal_names.push_back(
+              signal.name.substr(0, signal.name.find('[')));
+        }
+        const int idx = signal_scopes.size();
+        signal_scopes.push_back(std::move(match));
+        signal_scope_ptrs.push_back(&scope);
+        for (const auto &sub : scope.children) {
+          add_signals(sub, idx);
+        }
+      };
+  for (const auto &root_scope : wave_data_->Roots()) {
+    add_signals(root_scope, -1);
+  }
+  if (const auto match = MatchScopes(design_scopes, signal_scopes)) {
+    matched_design_scope_ = design_items[match->first];
+    matched_signal_scope_ = signal_scope_ptrs[match->second];
+  }
+  ApplyDesignData(matched_design_scope_, matched_signal_scope_);
+  UpdateSignalMap();
+}
+
+void Workspace::UpdateSignalMap() {
+  WaitForSignalMap();
+  signal_map_thread_ = std::thread([this, design_scope = matched_design_scope_,
+                                    signal_scope = matched_signal_scope_] {
+    signal_map_ = DesignSignalMap(design_scope, signal_scope);
+  });
+}
+
+void Workspace::WaitForSignalMap() const {
+  if (signal_map_thread_.joinable()) signal_map_thread_.join();
+}
+
+void Workspace::IndexSignals() {
+  WaitForSignalIndex();
+  signal_index_thread_ = std::thread([this] {
+    std::vector<SignalIndex::Scope> scopes;
+    std::vector<SignalIndex::Signal> signals;
+    indexed_signals_.clear();
+    std::vector<const WaveData::SignalScope *> order;
+    for (const auto &root : wave_data_->Roots()) {
+      order.push_back(&root);
+      scopes.push_back({.name = root.name, .parent = -1});
     }
-    if (g->Array_nets() != nullptr) {
-      for (const auto *a : *g->Array_nets()) {
-        if (array_match(a->VpiName(), signal->name)) return a;
+    // Breadth first, so that the parents come first.
+    for (int i = 0; i < order.size(); ++i) {
+      for (const auto &child : order[i]->children) {
+        order.push_back(&child);
+        scopes.push_back({.name = child.name, .parent = i});
       }
-    }
-    if (g->Array_vars() != nullptr) {
-      for (const auto *a : *g->Array_vars()) {
-        if (array_match(a->VpiName(), signal->name)) return a;
+      for (const auto &signal : order[i]->signals) {
+        signals.push_back({.name = signal.name, .scope = i});
+        indexed_signals_.push_back(&signal);
       }
     }
+    signal_index_ = std::make_unique<SignalIndex>(scopes, signals);
+  });
+}
+
+void Workspace::WaitForSignalIndex() const {
+  if (signal_index_thread_.joinable()) signal_index_thread_.join();
+}
+
+std::vector<const WaveData::Signal *>
+Workspace::FindSignals(std::string_view query, int max_results,
+                       int *num_matches) const {
+  WaitForSignalIndex();
+  if (signal_index_ == nullptr) return {};
+  std::vector<const WaveData::Signal *> signals;
+  for (const int i : signal_index_->Find(query, max_results, num_matches)) {
+    signals.push_back(indexed_signals_[i]);
   }
-  return nullptr;
+  return signals;
+}
+
+std::vector<const WaveData::Signal *>
+Workspace::DesignToSignals(const UHDM::any *item) const {
+  // Make sure it's actually something that would have ended up in a wave.
+  if (item == nullptr || !IsTraceable(item)) return {};
+  WaitForSignalMap();
+  return signal_map_.Signals(item);
+}
+
+const UHDM::any *
+Workspace::SignalToDesign(const WaveData::Signal *signal) const {
+  WaitForSignalMap();
+  return signal_map_.DesignItem(signal);
 }
 
 void Workspace::SetMatchedDesignScope(const UHDM::any *s) {
   matched_design_scope_ = s;
   ApplyDesignData(matched_design_scope_, matched_signal_scope_);
+  UpdateSignalMap();
 }
 
 void Workspace::SetMatchedSignalScope(const WaveData::SignalScope *s) {
   matched_signal_scope_ = s;
   ApplyDesignData(matched_design_scope_, matched_signal_scope_);
+  UpdateSignalMap();
 }
 
 } // namespace sv
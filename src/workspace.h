@@ -1,9 +1,17 @@
 #pragma once
 
 #include "absl/container/flat_hash_map.h"
+#include "connectivity_graph.h"
+#include "design_signal_map.h"
+#include "signal_index.h"
 #include "wave_data.h"
 #include <Surelog/surelog.h>
 #include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <uhdm/Serializer.h>
 #include <uhdm/design.h>
 #include <uhdm/module_inst.h>
 #include <vector>
@@ -20,12 +28,19 @@ class Workspace {
     return w;
   }
 
+  // Enables reusing the design database that Surelog writes, as long as the
+  // command line and the source files haven't changed since.
+  static void UseDesignCache(bool b) { use_design_cache_ = b; }
   // Parse the design using command line arguments for Surelog.
   // Return true on success.
   bool ParseDesign(int argc, const char *argv[]);
-  // Attempt to parse wave file. Return true on success.
+  // Attempt to parse wave file. Return true on success. This only touches the
+  // wave data, so it can run on another thread while ParseDesign() does.
   bool ReadWaves(const std::string &wave_file, bool keep_glitches);
   const UHDM::design *Design() const { return design_; }
+  // The connectivity of the design, which is built in the background once it
+  // is parsed. Null until then.
+  const ConnectivityGraph *Connectivity() const;
   // Find the definition of the module that contains the given item.
   const UHDM::module_inst *GetDefinition(const UHDM::module_inst *m);
   uint64_t &WaveCursorTime() { return wave_cursor_time_; }
@@ -35,6 +50,20 @@ class Workspace {
   const WaveData *Waves() const { return wave_data_.get(); }
   // Non-const version allows for reload.
   WaveData *Waves() { return wave_data_.get(); }
+  // Reloads the wave file, keeping the matched signal scope if it still
+  // exists. Signal pointers are no longer valid afterwards.
+  void ReloadWaves();
+  // Registers a function that is called before the waves are reloaded, which
+  // must stop anything reading them in the background and let go of signal
+  // pointers. The owner removes it again before it goes away.
+  void AddWavesReloadHook(const void *owner, std::function<void()> hook);
+  void RemoveWavesReloadHook(const void *owner);
+  // Finds signals anywhere in the waves by what is typed of their path, best
+  // matches first, see SignalIndex. The index is built in the background once
+  // the waves are read, this waits for it if needed.
+  std::vector<const WaveData::Signal *>
+  FindSignals(std::string_view query, int max_results,
+              int *num_matches = nullptr) const;
 
   void TryMatchDesignWithWaves();
   auto MatchedDesignScope() const { return matched_design_scope_; }
@@ -49,17 +78,40 @@ class Workspace {
   // Singleton
   Workspace() {}
   ~Workspace();
+  // Loads the design from the database at db_path, if the cache saved with
+  // it says it was built from the same inputs.
+  bool RestoreDesign(const std::string &db_path, std::string_view inputs);
+  // Rebuilds the signal map for the matched scopes in the background.
+  void UpdateSignalMap();
+  void WaitForSignalMap() const;
+  // Rebuilds the signal index for the waves in the background.
+  void IndexSignals();
+  void WaitForSignalIndex() const;
   // Track all definitions of any given module instance.
   // This serves as a cache to avoid iterating over the
   // design's list of all module definitions.
   absl::flat_hash_map<std::string, const UHDM::module_inst *> module_defs_;
   UHDM::design *design_ = nullptr;
+  // Owns the design when it was restored from a database instead.
+  std::unique_ptr<UHDM::Serializer> serializer_;
+  static bool use_design_cache_;
+  mutable std::mutex connectivity_mutex_;
+  std::unique_ptr<ConnectivityGraph> connectivity_;
+  std::thread connectivity_thread_;
   SURELOG::SymbolTable symbol_table_;
   SURELOG::scompiler *compiler_ = nullptr;
   std::vector<std::string_view> include_paths_;
   std::unique_ptr<WaveData> wave_data_;
   const WaveData::SignalScope *matched_signal_scope_ = nullptr;
   const UHDM::any *matched_design_scope_ = nullptr;
+  // Only used once the thread building it is done.
+  DesignSignalMap signal_map_;
+  mutable std::thread signal_map_thread_;
+  // Same for the signal index, and the signals by their index there.
+  std::unique_ptr<SignalIndex> signal_index_;
+  std::vector<const WaveData::Signal *> indexed_signals_;
+  mutable std::thread signal_index_thread_;
+  std::vector<std::pair<const void *, std::function<void()>>> reload_hooks_;
   // Wave time is used in source too, so it's held here.
   uint64_t wave_cursor_time_ = 0;
 };